@@ -0,0 +1,180 @@
+#include <QStringList>
+
+#include "catalogcache.h"
+#include "api.h"
+
+// events posted by the catalog triggers
+#define EVENT_ITEMS_CHANGED     "RP_ITEMS_CHANGED"
+#define EVENT_GROUPS_CHANGED    "RP_GROUPS_CHANGED"
+#define EVENT_PEOPLES_CHANGED   "RP_PEOPLES_CHANGED"
+#define EVENT_TABLES_CHANGED    "RP_TABLES_CHANGED"
+
+// generator incremented by the same triggers, polled when events are unavailable
+#define CATALOG_GENERATOR       "RP_CATALOG_GEN"
+
+CatalogCache::CatalogCache(QObject *parent) : QObject(parent)
+{
+    entries_.insert(COMMAND::CMD_ITEMS,          Entry());
+    entries_.insert(COMMAND::CMD_ITEMS_GROUPS,   Entry());
+    entries_.insert(COMMAND::CMD_GET_PEOPLES,    Entry());
+    entries_.insert(COMMAND::CMD_GET_TABLES,     Entry());
+}
+
+QStringList CatalogCache::eventNames()
+{
+    return QStringList() << EVENT_ITEMS_CHANGED << EVENT_GROUPS_CHANGED
+                         << EVENT_PEOPLES_CHANGED << EVENT_TABLES_CHANGED;
+}
+
+QString CatalogCache::generatorName()
+{
+    return CATALOG_GENERATOR;
+}
+
+bool CatalogCache::find(const QString &cmd, Request::Protocol protocol, QByteArray &response) const
+{
+    QReadLocker locker(&lock_);
+    QHash<QString, Entry>::const_iterator it = entries_.constFind(cmd);
+
+    if (it == entries_.constEnd() || it->valid == false || it->responses.contains(protocol) == false)
+        return false;
+
+    response = it->responses.value(protocol);
+    return true;
+}
+
+bool CatalogCache::findBody(const QString &cmd, QVariantMap &body, quint64 &generation) const
+{
+    QReadLocker locker(&lock_);
+    QHash<QString, Entry>::const_iterator it = entries_.constFind(cmd);
+
+    if (it == entries_.constEnd() || it->valid == false)
+        return false;
+
+    body = it->body;
+    generation = it->generation;
+    return true;
+}
+
+bool CatalogCache::findChanges(const QString &cmd, quint64 since, quint64 &version,
+                               QVariantList &changed, QVariantList &deleted) const
+{
+    QReadLocker locker(&lock_);
+    QHash<QString, Entry>::const_iterator it = entries_.constFind(cmd);
+
+    if (it == entries_.constEnd() || it->log.changesSince(since, changed, deleted) == false)
+        return false;
+
+    version = it->log.version();
+    return true;
+}
+
+quint64 CatalogCache::generation(const QString &cmd) const
+{
+    QReadLocker locker(&lock_);
+
+    return entries_.value(cmd).generation;
+}
+
+quint64 CatalogCache::updateRows(const QString &cmd, quint64 generation, const QVariantList &rows)
+{
+    QWriteLocker locker(&lock_);
+    QHash<QString, Entry>::iterator it = entries_.find(cmd);
+
+    // invalidated while the rows were being read
+    if (it == entries_.end() || it->generation != generation)
+        return 0;
+
+    return it->log.update(rows);
+}
+
+bool CatalogCache::insert(const QString &cmd, quint64 generation, const QVariantMap &body)
+{
+    QWriteLocker locker(&lock_);
+    QHash<QString, Entry>::iterator it = entries_.find(cmd);
+
+    if (it == entries_.end() || it->generation != generation)
+        return false;
+
+    it->body = body;
+    it->responses.clear();
+    it->valid = true;
+
+    return true;
+}
+
+void CatalogCache::insert(const QString &cmd, quint64 generation, Request::Protocol protocol, const QByteArray &response)
+{
+    QWriteLocker locker(&lock_);
+    QHash<QString, Entry>::iterator it = entries_.find(cmd);
+
+    if (it == entries_.end() || it->generation != generation || it->valid == false)
+        return;
+
+    it->responses.insert(protocol, response);
+}
+
+// Fills a catalog from the snapshot, encoded responses included, before
+// the database has been reached. The body keeps its saved version.
+void CatalogCache::restore(const QString &cmd, const QVariantList &rows, const QVariantMap &body,
+                           const QHash<int, QByteArray> &responses)
+{
+    QWriteLocker locker(&lock_);
+    QHash<QString, Entry>::iterator it = entries_.find(cmd);
+
+    if (it == entries_.end())
+        return;
+
+    it->body = body;
+    it->responses = responses;
+    it->valid = true;
+    it->log.restore(rows, body.value("version").toULongLong());
+}
+
+void CatalogCache::invalidate(const QString &cmd)
+{
+    {
+        QWriteLocker locker(&lock_);
+        QHash<QString, Entry>::iterator it = entries_.find(cmd);
+
+        if (it == entries_.end())
+            return;
+
+        it->generation++;
+        it->valid = false;
+        it->body.clear();
+        it->responses.clear();
+    }
+
+    Q_EMIT invalidated(cmd);
+}
+
+void CatalogCache::invalidateAll()
+{
+    {
+        QWriteLocker locker(&lock_);
+
+        for (QHash<QString, Entry>::iterator it = entries_.begin(); it != entries_.end(); ++it) {
+            it->generation++;
+            it->valid = false;
+            it->body.clear();
+            it->responses.clear();
+        }
+    }
+
+    Q_EMIT invalidated(QString());
+}
+
+void CatalogCache::onDbEvent(const QString &name)
+{
+    if (name == EVENT_ITEMS_CHANGED)
+        invalidate(COMMAND::CMD_ITEMS);
+    else if (name == EVENT_GROUPS_CHANGED)
+        invalidate(COMMAND::CMD_ITEMS_GROUPS);
+    else if (name == EVENT_PEOPLES_CHANGED)
+        invalidate(COMMAND::CMD_GET_PEOPLES);
+    else if (name == EVENT_TABLES_CHANGED)
+        invalidate(COMMAND::CMD_GET_TABLES);
+    else if (name.isEmpty() == true)
+        invalidateAll();
+}
@@ -0,0 +1,61 @@
+#ifndef CATALOGCACHE_H
+#define CATALOGCACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QStringList>
+#include <QReadWriteLock>
+
+#include "catalogchangelog.h"
+#include "request.h"
+
+// Keeps the responses of the catalog commands, already encoded for each
+// protocol, together with the change log of their rows. Every catalog
+// has its own generation, bumped on each invalidation, so data read
+// before an invalidation is never stored.
+class CatalogCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CatalogCache(QObject *parent = 0);
+
+    static QStringList eventNames();
+    static QString generatorName();
+
+    bool find(const QString &cmd, Request::Protocol protocol, QByteArray &response) const;
+    bool findBody(const QString &cmd, QVariantMap &body, quint64 &generation) const;
+    bool findChanges(const QString &cmd, quint64 since, quint64 &version,
+                     QVariantList &changed, QVariantList &deleted) const;
+    quint64 generation(const QString &cmd) const;
+
+    quint64 updateRows(const QString &cmd, quint64 generation, const QVariantList &rows);
+    bool insert(const QString &cmd, quint64 generation, const QVariantMap &body);
+    void insert(const QString &cmd, quint64 generation, Request::Protocol protocol, const QByteArray &response);
+    void restore(const QString &cmd, const QVariantList &rows, const QVariantMap &body,
+                 const QHash<int, QByteArray> &responses);
+
+Q_SIGNALS:
+    void invalidated(const QString &cmd);
+
+public Q_SLOTS:
+    void invalidate(const QString &cmd);
+    void invalidateAll();
+    void onDbEvent(const QString &name);
+
+private:
+    struct Entry {
+        Entry() : generation(1), valid(false) {}
+
+        quint64 generation;
+        bool valid;
+        QVariantMap body;
+        QHash<int, QByteArray> responses;
+        CatalogChangeLog log;
+    };
+
+    mutable QReadWriteLock lock_;
+    QHash<QString, Entry> entries_;
+};
+
+#endif // CATALOGCACHE_H
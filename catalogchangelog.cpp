@@ -0,0 +1,105 @@
+#include <QDateTime>
+#include <QSet>
+
+#include "catalogchangelog.h"
+
+// deleted keys kept for deltas, older clients get the full catalog
+static const int MAX_DELETED_KEYS = 10000;
+
+CatalogChangeLog::CatalogChangeLog(const QString &keyField) :
+    keyField_(keyField),
+    version_(0),
+    baseVersion_(0)
+{
+}
+
+quint64 CatalogChangeLog::update(const QVariantList &rows)
+{
+    QSet<QString> keys;
+    bool changed = false;
+    quint64 next = version_ == 0 ? QDateTime::currentMSecsSinceEpoch() : version_ + 1;
+
+    foreach (const QVariant &row, rows) {
+        QString key = row.toMap().value(keyField_).toString();
+
+        // rows without a key can't be tracked, deltas stay off until they are gone
+        if (key.isEmpty() == true) {
+            baseVersion_ = next;
+            changed = true;
+            continue;
+        }
+
+        keys.insert(key);
+
+        QHash<QString, Row>::iterator it = rows_.find(key);
+        if (it == rows_.end()) {
+            rows_.insert(key, Row(row, next));
+            deleted_.remove(key);
+            changed = true;
+        }
+        else if (it->data != row) {
+            it->data = row;
+            it->version = next;
+            changed = true;
+        }
+    }
+
+    for (QHash<QString, Row>::iterator it = rows_.begin(); it != rows_.end(); ) {
+        if (keys.contains(it.key()) == false) {
+            deleted_.insert(it.key(), next);
+            it = rows_.erase(it);
+            changed = true;
+        }
+        else
+            ++it;
+    }
+
+    if (deleted_.size() > MAX_DELETED_KEYS) {
+        deleted_.clear();
+        baseVersion_ = next;
+    }
+
+    if (version_ == 0)
+        baseVersion_ = next;
+
+    if (changed == true || version_ == 0)
+        version_ = next;
+
+    return version_;
+}
+
+// Starts over from rows saved at that version, every row counts as
+// unchanged since then.
+void CatalogChangeLog::restore(const QVariantList &rows, quint64 version)
+{
+    rows_.clear();
+    deleted_.clear();
+
+    foreach (const QVariant &row, rows) {
+        QString key = row.toMap().value(keyField_).toString();
+
+        if (key.isEmpty() == false)
+            rows_.insert(key, Row(row, version));
+    }
+
+    version_ = version;
+    baseVersion_ = version;
+}
+
+bool CatalogChangeLog::changesSince(quint64 since, QVariantList &changed, QVariantList &deleted) const
+{
+    if (version_ == 0 || since < baseVersion_ || since > version_)
+        return false;
+
+    for (QHash<QString, Row>::const_iterator it = rows_.constBegin(); it != rows_.constEnd(); ++it) {
+        if (it->version > since)
+            changed << it->data;
+    }
+
+    for (QHash<QString, quint64>::const_iterator it = deleted_.constBegin(); it != deleted_.constEnd(); ++it) {
+        if (it.value() > since)
+            deleted << it.key();
+    }
+
+    return true;
+}
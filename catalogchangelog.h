@@ -0,0 +1,40 @@
+#ifndef CATALOGCHANGELOG_H
+#define CATALOGCHANGELOG_H
+
+#include <QHash>
+#include <QVariant>
+
+// Tracks the rows of one catalog between reloads. Every reload that adds,
+// changes or removes rows gets a new version, so a client can ask for the
+// rows changed after the version it already has. Versions start from the
+// load time, a client holding a version from before a restart gets the
+// full catalog, unless the catalog came back from the snapshot with its
+// version.
+class CatalogChangeLog
+{
+public:
+    explicit CatalogChangeLog(const QString &keyField = "id");
+
+    quint64 update(const QVariantList &rows);
+    void restore(const QVariantList &rows, quint64 version);
+    quint64 version() const { return version_; }
+
+    bool changesSince(quint64 since, QVariantList &changed, QVariantList &deleted) const;
+
+private:
+    struct Row {
+        Row() : version(0) {}
+        Row(const QVariant &d, quint64 v) : data(d), version(v) {}
+
+        QVariant data;
+        quint64 version;
+    };
+
+    QString keyField_;
+    quint64 version_;
+    quint64 baseVersion_;
+    QHash<QString, Row> rows_;
+    QHash<QString, quint64> deleted_;
+};
+
+#endif // CATALOGCHANGELOG_H
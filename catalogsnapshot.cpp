@@ -0,0 +1,232 @@
+#include <QFile>
+#include <QSaveFile>
+#include <QCborValue>
+#include <QCborMap>
+#include <QtEndian>
+#include <cstring>
+
+#include "catalogsnapshot.h"
+#include "request.h"
+
+// start of every snapshot file, followed by the format
+#define SNAPSHOT_MAGIC      "RPCATSNP"
+
+static const int SNAPSHOT_MAGIC_SIZE = 8;
+
+// bumped whenever the layout below changes, older files are ignored
+//
+//   magic, format, database name, catalog count, then per catalog its
+//   command, rows key, JSON response and CBOR response; numbers are
+//   32-bit big-endian, byte strings are their size and bytes
+static const quint32 SNAPSHOT_FORMAT = 1;
+
+// Walks the mapped file, a read past its end leaves ok false.
+struct SnapshotReader {
+    SnapshotReader(const uchar *data, qint64 size) : pos(data), end(data + size), ok(true) {}
+
+    quint32 number()
+    {
+        quint32 value;
+
+        if (ok == false || end - pos < 4) {
+            ok = false;
+            return 0;
+        }
+
+        value = qFromBigEndian<quint32>(pos);
+        pos += 4;
+        return value;
+    }
+
+    // points into the map, copied by the caller when it has to outlive it
+    QByteArray bytes()
+    {
+        quint32 size = number();
+        QByteArray value;
+
+        if (ok == false || quint64(end - pos) < size) {
+            ok = false;
+            return value;
+        }
+
+        value = QByteArray::fromRawData(reinterpret_cast<const char *>(pos), int(size));
+        pos += size;
+        return value;
+    }
+
+    const uchar *pos;
+    const uchar *end;
+    bool ok;
+};
+
+static void appendNumber(QByteArray &out, quint32 value)
+{
+    char data[4];
+
+    qToBigEndian(value, data);
+    out.append(data, sizeof(data));
+}
+
+static void appendBytes(QByteArray &out, const QByteArray &bytes)
+{
+    appendNumber(out, quint32(bytes.size()));
+    out.append(bytes);
+}
+
+CatalogSnapshot::CatalogSnapshot(const QString &fileName, const QString &dbName) :
+    fileName_(fileName),
+    dbName_(dbName)
+{
+}
+
+// Maps the file and decodes every catalog in it. A missing file is no
+// error, there is just nothing to serve yet.
+bool CatalogSnapshot::load(QList<Catalog> &catalogs, QString &errText)
+{
+    QFile file(fileName_);
+    uchar *data;
+    quint32 count;
+
+    catalogs.clear();
+    records_.clear();
+
+    if (file.exists() == false)
+        return true;
+
+    if (file.open(QIODevice::ReadOnly) == false) {
+        errText = file.errorString();
+        return false;
+    }
+
+    data = file.map(0, file.size());
+    if (data == 0) {
+        errText = file.errorString();
+        return false;
+    }
+
+    SnapshotReader reader(data, file.size());
+
+    if (file.size() < SNAPSHOT_MAGIC_SIZE || std::memcmp(data, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE) != 0) {
+        errText = "not a catalog snapshot";
+        file.unmap(data);
+        return false;
+    }
+    reader.pos += SNAPSHOT_MAGIC_SIZE;
+
+    if (reader.number() != SNAPSHOT_FORMAT) {
+        errText = "snapshot of another format";
+        file.unmap(data);
+        return false;
+    }
+
+    if (QString::fromUtf8(reader.bytes()) != dbName_) {
+        errText = "snapshot of another database";
+        file.unmap(data);
+        return false;
+    }
+
+    count = reader.number();
+    for (quint32 x = 0; x < count && reader.ok == true; ++x) {
+        const uchar *start = reader.pos;
+        Catalog catalog;
+        QByteArray json;
+        QByteArray cbor;
+
+        catalog.cmd = QString::fromUtf8(reader.bytes());
+        catalog.key = QString::fromUtf8(reader.bytes());
+        json = reader.bytes();
+        cbor = reader.bytes();
+        if (reader.ok == false)
+            break;
+
+        // the CBOR response is the body itself
+        catalog.body = QCborValue::fromCbor(cbor).toMap().toVariantMap();
+        if (catalog.body.contains(catalog.key) == false)
+            continue;
+
+        catalog.responses.insert(Request::Json, QByteArray(json.constData(), json.size()));
+        catalog.responses.insert(Request::Cbor, QByteArray(cbor.constData(), cbor.size()));
+        catalogs << catalog;
+
+        records_.insert(catalog.cmd, QByteArray(reinterpret_cast<const char *>(start), int(reader.pos - start)));
+        versions_.insert(catalog.cmd, catalog.body.value("version").toULongLong());
+    }
+
+    file.unmap(data);
+
+    if (reader.ok == false) {
+        errText = "snapshot cut short";
+        catalogs.clear();
+        records_.clear();
+        versions_.clear();
+        return false;
+    }
+
+    return true;
+}
+
+// Keeps a freshly loaded catalog for the next save. A body older than
+// the one already kept, read before an invalidation, is dropped.
+void CatalogSnapshot::update(const QString &cmd, const QString &key, const QVariantMap &body)
+{
+    QMutexLocker locker(&mutex_);
+    quint64 version = body.value("version").toULongLong();
+    Pending pending;
+
+    if (versions_.contains(cmd) == true && versions_.value(cmd) > version)
+        return;
+
+    pending.key = key;
+    pending.body = body;
+    pending_.insert(cmd, pending);
+    versions_.insert(cmd, version);
+}
+
+// Encodes the catalogs loaded since the last save and replaces the file
+// with all of them, those not reloaded stay as they were.
+bool CatalogSnapshot::save(QString &errText)
+{
+    QHash<QString, Pending> pending;
+    QSaveFile file(fileName_);
+    QByteArray header;
+
+    {
+        QMutexLocker locker(&mutex_);
+
+        pending.swap(pending_);
+    }
+
+    if (pending.isEmpty() == true)
+        return true;
+
+    for (QHash<QString, Pending>::const_iterator it = pending.constBegin(); it != pending.constEnd(); ++it) {
+        QByteArray record;
+
+        appendBytes(record, it.key().toUtf8());
+        appendBytes(record, it->key.toUtf8());
+        appendBytes(record, Request::encode(it->body, Request::Json));
+        appendBytes(record, Request::encode(it->body, Request::Cbor));
+        records_.insert(it.key(), record);
+    }
+
+    header.append(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE);
+    appendNumber(header, SNAPSHOT_FORMAT);
+    appendBytes(header, dbName_.toUtf8());
+    appendNumber(header, quint32(records_.size()));
+
+    if (file.open(QIODevice::WriteOnly) == false) {
+        errText = file.errorString();
+        return false;
+    }
+
+    file.write(header);
+    foreach (const QByteArray &record, records_)
+        file.write(record);
+
+    if (file.commit() == false) {
+        errText = file.errorString();
+        return false;
+    }
+
+    return true;
+}
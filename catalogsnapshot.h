@@ -0,0 +1,51 @@
+#ifndef CATALOGSNAPSHOT_H
+#define CATALOGSNAPSHOT_H
+
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QVariant>
+
+// The last good catalogs on disk, so a restarted server answers the
+// catalog commands before it has reached the database. Each catalog is
+// kept with its version and its responses already encoded for both
+// protocols. The file is replaced whole through QSaveFile and read back
+// through a memory map; a file of another format or another database is
+// ignored.
+class CatalogSnapshot
+{
+public:
+    struct Catalog {
+        QString cmd;
+        QString key;
+        QVariantMap body;
+        QHash<int, QByteArray> responses;
+    };
+
+    CatalogSnapshot(const QString &fileName, const QString &dbName);
+
+    QString fileName() const { return fileName_; }
+
+    bool load(QList<Catalog> &catalogs, QString &errText);
+    void update(const QString &cmd, const QString &key, const QVariantMap &body);
+    bool save(QString &errText);
+
+private:
+    struct Pending {
+        QString key;
+        QVariantMap body;
+    };
+
+    QString fileName_;
+    QString dbName_;
+
+    // catalogs loaded since the last save, any thread
+    QMutex mutex_;
+    QHash<QString, Pending> pending_;
+    QHash<QString, quint64> versions_;
+
+    // encoded catalogs as written, only touched by load and save
+    QMap<QString, QByteArray> records_;
+};
+
+#endif // CATALOGSNAPSHOT_H
@@ -0,0 +1,109 @@
+#ifndef COMMANDTABLE_H
+#define COMMANDTABLE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// Command name to handler lookup by a perfect hash over the raw UTF-8
+// name. The names come from api.h at run time, so the table is built
+// once at startup: seeds are tried until every name lands in its own
+// slot. A lookup is one hash, one slot and one compare, with no QString
+// made from the request.
+template <typename T>
+class CommandTable
+{
+public:
+    struct Entry {
+        Entry() : handler() {}
+
+        QByteArray name;
+        QString text;
+        T handler;
+    };
+
+    CommandTable() : seed_(0), mask_(0) {}
+
+    void insert(const QString &name, T handler)
+    {
+        Entry entry;
+
+        for (int x = 0; x < entries_.size(); ++x) {
+            if (entries_[x].text == name) {
+                entries_[x].handler = handler;
+                return;
+            }
+        }
+
+        entry.name = name.toUtf8();
+        entry.text = name;
+        entry.handler = handler;
+        entries_ << entry;
+        build();
+    }
+
+    const Entry *find(const QByteArray &name) const
+    {
+        if (slots_.isEmpty() == true)
+            return 0;
+
+        int slot = slots_[hash(name.constData(), name.size(), seed_) & mask_];
+
+        if (slot < 0 || entries_[slot].name != name)
+            return 0;
+
+        return &entries_[slot];
+    }
+
+private:
+    QVector<Entry> entries_;
+    QVector<int> slots_;
+    quint32 seed_;
+    quint32 mask_;
+
+    // FNV-1a with the seed folded into the offset basis
+    static quint32 hash(const char *data, int size, quint32 seed)
+    {
+        quint32 h = 2166136261u ^ seed;
+
+        for (int x = 0; x < size; ++x) {
+            h ^= uchar(data[x]);
+            h *= 16777619u;
+        }
+
+        return h ^ (h >> 15);
+    }
+
+    // Twice as many slots as names, grown again if no seed of a round
+    // separates them.
+    void build()
+    {
+        int size = 1;
+
+        while (size < entries_.size() * 2)
+            size <<= 1;
+
+        for (;; size <<= 1) {
+            for (quint32 seed = 0; seed < 1024; ++seed) {
+                QVector<int> slots(size, -1);
+                bool clash = false;
+
+                for (int x = 0; x < entries_.size() && clash == false; ++x) {
+                    int &slot = slots[hash(entries_[x].name.constData(), entries_[x].name.size(), seed) & (size - 1)];
+
+                    clash = slot >= 0;
+                    slot = x;
+                }
+
+                if (clash == false) {
+                    slots_ = slots;
+                    seed_ = seed;
+                    mask_ = size - 1;
+                    return;
+                }
+            }
+        }
+    }
+};
+
+#endif // COMMANDTABLE_H
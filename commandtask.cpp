@@ -0,0 +1,34 @@
+#include "commandtask.h"
+#include "rpserver.h"
+
+CommandTask::CommandTask(RPServer *server, ConnectionShard *shard, QWebSocket *socket, quint64 connectionId,
+                         Request::Protocol protocol, const QByteArray &message) :
+    server_(server),
+    shard_(shard),
+    socket_(socket),
+    connectionId_(connectionId),
+    protocol_(protocol),
+    message_(message)
+{
+    setAutoDelete(true);
+}
+
+CommandTask::CommandTask(RPServer *server, ConnectionShard *shard, QWebSocket *socket, quint64 connectionId,
+                         Request::Protocol protocol, const QJsonObject &json) :
+    server_(server),
+    shard_(shard),
+    socket_(socket),
+    connectionId_(connectionId),
+    protocol_(protocol),
+    json_(json)
+{
+    setAutoDelete(true);
+}
+
+void CommandTask::run()
+{
+    if (message_.isEmpty() == true)
+        server_->runCommand(Request(shard_, socket_, connectionId_, protocol_, json_));
+    else
+        server_->runCommand(Request(shard_, socket_, connectionId_, protocol_, message_));
+}
@@ -0,0 +1,36 @@
+#ifndef COMMANDTASK_H
+#define COMMANDTASK_H
+
+#include <QRunnable>
+#include <QByteArray>
+
+#include "request.h"
+
+class RPServer;
+class ConnectionShard;
+class QWebSocket;
+
+// Runs one client command on the worker pool, the reply is posted back
+// to the I/O thread owning the socket. The command is either a raw frame,
+// decoded on the worker, or one already decoded out of a batch.
+class CommandTask : public QRunnable
+{
+public:
+    CommandTask(RPServer *server, ConnectionShard *shard, QWebSocket *socket, quint64 connectionId,
+                Request::Protocol protocol, const QByteArray &message);
+    CommandTask(RPServer *server, ConnectionShard *shard, QWebSocket *socket, quint64 connectionId,
+                Request::Protocol protocol, const QJsonObject &json);
+
+    void run();
+
+private:
+    RPServer *server_;
+    ConnectionShard *shard_;
+    QWebSocket *socket_;
+    quint64 connectionId_;
+    Request::Protocol protocol_;
+    QByteArray message_;
+    QJsonObject json_;
+};
+
+#endif // COMMANDTASK_H
@@ -0,0 +1,358 @@
+#include <QWebSocketServer>
+#include <QWebSocket>
+#include <QTcpSocket>
+#include <QUrlQuery>
+#include <QTimer>
+
+#include "connectionshard.h"
+#include "rpserver.h"
+#include "commandtask.h"
+#include "tablemonitor.h"
+#include "serverstats.h"
+#include "api.h"
+
+// first byte of a compressed binary frame, never the first byte of a CBOR reply
+static const char COMPRESSED_FRAME = '\x01';
+
+// a push is held back from a socket with more than this part of the
+// write queue limit still unsent
+static const int PUSH_QUEUE_DIVISOR = 2;
+
+// without heartbeats idle connections are checked this many times per
+// idle timeout
+static const int IDLE_CHECKS_PER_TIMEOUT = 4;
+
+ConnectionShard::ConnectionShard(RPServer *server, int index) : QObject(0),
+    server_(server),
+    index_(index),
+    webSocketServer_(0),
+    heartbeatTimer_(0),
+    nextConnectionId_(0)
+{
+}
+
+// Runs on the shard's own thread, so the websocket server, the timer and
+// every socket live there.
+void ConnectionShard::start()
+{
+    clock_.start();
+
+    webSocketServer_ = new QWebSocketServer("RPServer", QWebSocketServer::NonSecureMode, this);
+    connect(webSocketServer_, &QWebSocketServer::newConnection, this, &ConnectionShard::onNewConnection);
+
+    if (server_->heartbeatInterval_ > 0 || server_->idleTimeout_ > 0) {
+        int interval = server_->heartbeatInterval_ * 1000;
+
+        if (interval == 0)
+            interval = qMax(1000, server_->idleTimeout_ * 1000 / IDLE_CHECKS_PER_TIMEOUT);
+
+        heartbeatTimer_ = new QTimer(this);
+        connect(heartbeatTimer_, &QTimer::timeout, this, &ConnectionShard::checkConnections);
+        heartbeatTimer_->start(interval);
+    }
+}
+
+// The socket is made here, not on the acceptor's thread, so it belongs to
+// this shard's event loop from the start.
+void ConnectionShard::addConnection(qintptr descriptor)
+{
+    QTcpSocket *socket = new QTcpSocket();
+
+    if (socket->setSocketDescriptor(descriptor) == false) {
+        addLogError(QString(trUtf8("I/O shard %1 could not take a connection: %2")).arg(index_).arg(socket->errorString()));
+        delete socket;
+        return;
+    }
+
+    webSocketServer_->handleConnection(socket);
+}
+
+void ConnectionShard::addLogDebug(const QString &text)
+{
+    server_->log_->write(ServerLog::Debug, text);
+}
+
+void ConnectionShard::addLogInfo(const QString &text)
+{
+    server_->log_->write(ServerLog::Info, text);
+}
+
+void ConnectionShard::addLogError(const QString &text)
+{
+    server_->log_->write(ServerLog::Error, text);
+}
+
+void ConnectionShard::onNewConnection()
+{
+    QWebSocket *pSocket = webSocketServer_->nextPendingConnection();
+    QUrlQuery query(pSocket->requestUrl());
+    Connection connection;
+
+    // sockets still open at shutdown go with the shard
+    pSocket->setParent(this);
+
+    if (server_->reserveConnection() == false) {
+        addLogError(QString(trUtf8("Connection from %1 refused, %2 clients connected"))
+                    .arg(pSocket->peerAddress().toString()).arg(server_->maxConnections_));
+        connect(pSocket, &QWebSocket::disconnected, pSocket, &QObject::deleteLater);
+        pSocket->close(QWebSocketProtocol::CloseCodePolicyViolated, "too_many_connections");
+        return;
+    }
+
+    connection.id = ++nextConnectionId_;
+    connection.lastSeen = clock_.elapsed();
+
+    // binary CBOR is asked for in the handshake url: ws://host:port/?protocol=cbor
+    if (query.queryItemValue("protocol") == "cbor")
+        connection.protocol = Request::Cbor;
+
+    // large replies compressed on one deflate stream: ws://host:port/?compress=deflate
+    if (query.queryItemValue("compress") == "deflate" && server_->compressThreshold_ > 0)
+        connection.deflater.reset(new Deflater());
+
+    connect(pSocket, &QWebSocket::textMessageReceived, this, &ConnectionShard::processTextMessage);
+    connect(pSocket, &QWebSocket::binaryMessageReceived, this, &ConnectionShard::processBinaryMessage);
+    connect(pSocket, &QWebSocket::disconnected, this, &ConnectionShard::socketDisconnected);
+    connect(pSocket, &QWebSocket::pong, this, &ConnectionShard::onPong);
+
+    connections_.insert(pSocket, connection);
+    server_->stats_->connectionOpened();
+}
+
+// The connection a worker's reply is for. The socket is only a key, a
+// closed one may be gone and its address taken by a new socket, so the
+// serial has to match too.
+ConnectionShard::Connection *ConnectionShard::find(QWebSocket *pSocket, quint64 connectionId)
+{
+    QHash<QWebSocket *, Connection>::iterator it = connections_.find(pSocket);
+
+    if (it == connections_.end() || it->id != connectionId)
+        return 0;
+
+    return &it.value();
+}
+
+void ConnectionShard::touch(QWebSocket *pSocket)
+{
+    QHash<QWebSocket *, Connection>::iterator it = connections_.find(pSocket);
+
+    if (it != connections_.end())
+        it->lastSeen = clock_.elapsed();
+}
+
+void ConnectionShard::onPong()
+{
+    QWebSocket *pSocket = qobject_cast<QWebSocket *>(sender());
+
+    if (pSocket)
+        touch(pSocket);
+}
+
+// Pings every client each heartbeat, if heartbeats are on. A client
+// silent for longer than the idle timeout, pongs included, is taken for a
+// dead Wi-Fi link and closed.
+void ConnectionShard::checkConnections()
+{
+    qint64 now = clock_.elapsed();
+    QList<QWebSocket *> idle;
+
+    for (QHash<QWebSocket *, Connection>::const_iterator it = connections_.constBegin(); it != connections_.constEnd(); ++it) {
+        if (server_->idleTimeout_ > 0 && now - it->lastSeen > qint64(server_->idleTimeout_) * 1000)
+            idle << it.key();
+        else if (server_->heartbeatInterval_ > 0)
+            it.key()->ping();
+    }
+
+    // closing may remove the connection right away, so not while iterating
+    foreach (QWebSocket *pSocket, idle) {
+        addLogInfo(QString(trUtf8("Closing idle connection from %1")).arg(pSocket->peerAddress().toString()));
+        pSocket->close(QWebSocketProtocol::CloseCodeGoingAway, "idle_timeout");
+    }
+}
+
+void ConnectionShard::processTextMessage(QString message)
+{
+    addLogDebug(message);
+
+    QWebSocket *pSocket = qobject_cast<QWebSocket *>(sender());
+    if (pSocket)
+        queueCommand(pSocket, message.toUtf8());
+}
+
+void ConnectionShard::processBinaryMessage(QByteArray message)
+{
+    QWebSocket *pSocket = qobject_cast<QWebSocket *>(sender());
+    if (pSocket) {
+        addLogDebug(QString(trUtf8("<binary request, %1 bytes>").arg(message.size())));
+        queueCommand(pSocket, message);
+    }
+}
+
+void ConnectionShard::queueCommand(QWebSocket *pSocket, const QByteArray &message)
+{
+    QHash<QWebSocket *, Connection>::iterator it = connections_.find(pSocket);
+
+    if (it == connections_.end())
+        return;
+
+    server_->stats_->addBytesIn(message.size());
+    it->lastSeen = clock_.elapsed();
+
+    if (server_->reserveCommand() == false) {
+        sendResponse(pSocket, it->id, Request::encode(RPServer::errorReply("server_busy"), it->protocol));
+        return;
+    }
+
+    server_->threadPool_.start(new CommandTask(server_, this, pSocket, it->id, it->protocol, message));
+}
+
+void ConnectionShard::sendResponse(QWebSocket *pSocket, quint64 connectionId, const QByteArray &result)
+{
+    Connection *connection = find(pSocket, connectionId);
+
+    // the socket may be gone while the command was running
+    if (!connection)
+        return;
+
+    if (connection->protocol == Request::Cbor)
+        addLogDebug(QString(trUtf8("<binary response, %1 bytes>").arg(result.size())));
+    else
+        addLogDebug(QString::fromUtf8(result));
+
+    writeMessage(pSocket, *connection, result);
+}
+
+// Replies over the threshold go as a binary frame holding the marker byte
+// and the next chunk of the connection's deflate stream. A client whose
+// unsent data is over the write queue limit is too slow to keep up and
+// gets dropped instead, the abort is queued as it may remove the
+// connection the caller is iterating over.
+bool ConnectionShard::writeMessage(QWebSocket *pSocket, const Connection &connection, const QByteArray &message)
+{
+    if (server_->maxWriteQueue_ > 0 && pSocket->bytesToWrite() > server_->maxWriteQueue_) {
+        addLogError(QString(trUtf8("Dropping slow client %1, %2 bytes unsent"))
+                    .arg(pSocket->peerAddress().toString()).arg(pSocket->bytesToWrite()));
+        QMetaObject::invokeMethod(pSocket, "abort", Qt::QueuedConnection);
+        return false;
+    }
+
+    if (connection.deflater && message.size() >= server_->compressThreshold_) {
+        QByteArray compressed = connection.deflater->compress(message);
+
+        if (compressed.isEmpty() == false) {
+            server_->stats_->addBytesOut(pSocket->sendBinaryMessage(compressed.prepend(COMPRESSED_FRAME)));
+            return true;
+        }
+    }
+
+    if (connection.protocol == Request::Cbor)
+        server_->stats_->addBytesOut(pSocket->sendBinaryMessage(message));
+    else
+        server_->stats_->addBytesOut(pSocket->sendTextMessage(QString::fromUtf8(message)));
+
+    return true;
+}
+
+void ConnectionShard::setTopics(QWebSocket *pSocket, quint64 connectionId, const QStringList &topics,
+                                const QJsonValue &reqId)
+{
+    Connection *connection = find(pSocket, connectionId);
+    QVariantMap pMap;
+    QVariantList tables;
+
+    if (!connection)
+        return;
+
+    connection->topics = QSet<QString>(topics.begin(), topics.end());
+
+    pMap["err"] = ERROR::API_ERROR_NONE;
+    pMap["res"] = COMMAND::CMD_SUBSCRIBE;
+    pMap["topics"] = topics;
+    if (reqId.isUndefined() == false)
+        pMap["req_id"] = reqId.toVariant();
+
+    // current state goes with the ack so no push can fall in between
+    if (connection->topics.contains(TOPIC_TABLES) == true && server_->tableMonitor_->tables(tables) == true)
+        pMap["tables"] = tables;
+
+    sendResponse(pSocket, connectionId, Request::encode(pMap, connection->protocol));
+}
+
+// A client lagging behind on its socket skips pushes, it only needs the
+// latest state anyway: it is marked for resync and gets the full
+// occupancy with "full" set once it has caught up.
+void ConnectionShard::publishTables(const QVariantMap &body)
+{
+    QByteArray json;
+    QByteArray cbor;
+    int count = 0;
+
+    // encoded once per protocol, whatever the number of subscribers
+    for (QHash<QWebSocket *, Connection>::iterator it = connections_.begin(); it != connections_.end(); ++it) {
+        if (it->topics.contains(TOPIC_TABLES) == false)
+            continue;
+
+        if (server_->maxWriteQueue_ > 0 && it.key()->bytesToWrite() > server_->maxWriteQueue_ / PUSH_QUEUE_DIVISOR) {
+            it->resync = true;
+            continue;
+        }
+
+        if (it->resync == true) {
+            QVariantMap full = body;
+            QVariantList tables;
+
+            server_->tableMonitor_->tables(tables);
+            full["tables"] = tables;
+            full["freed"] = QVariantList();
+            full["full"] = true;
+            it->resync = writeMessage(it.key(), it.value(), Request::encode(full, it->protocol)) == false;
+            count++;
+            continue;
+        }
+
+        if (it->protocol == Request::Cbor) {
+            if (cbor.isEmpty() == true)
+                cbor = Request::encode(body, Request::Cbor);
+            writeMessage(it.key(), it.value(), cbor);
+        }
+        else {
+            if (json.isEmpty() == true)
+                json = Request::encode(body, Request::Json);
+            writeMessage(it.key(), it.value(), json);
+        }
+        count++;
+    }
+
+    if (count > 0)
+        addLogDebug(QString(trUtf8("Table occupancy pushed to %1 clients").arg(count)));
+}
+
+void ConnectionShard::socketDisconnected()
+{
+    QWebSocket *pSocket = qobject_cast<QWebSocket *>(sender());
+
+    if (pSocket) {
+        if (connections_.remove(pSocket) > 0) {
+            server_->releaseConnection();
+            server_->stats_->connectionClosed();
+        }
+        pSocket->deleteLater();
+    }
+}
+
+//=============================================================================
+// class ConnectionAcceptor
+//=============================================================================
+ConnectionAcceptor::ConnectionAcceptor(const QList<ConnectionShard *> &shards, QObject *parent) : QTcpServer(parent),
+    shards_(shards),
+    next_(0)
+{
+}
+
+void ConnectionAcceptor::incomingConnection(qintptr descriptor)
+{
+    ConnectionShard *shard = shards_[next_];
+
+    next_ = (next_ + 1) % shards_.size();
+    QMetaObject::invokeMethod(shard, "addConnection", Qt::QueuedConnection, Q_ARG(qintptr, descriptor));
+}
@@ -0,0 +1,95 @@
+#ifndef CONNECTIONSHARD_H
+#define CONNECTIONSHARD_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QHash>
+#include <QSet>
+#include <QSharedPointer>
+#include <QElapsedTimer>
+
+#include "request.h"
+#include "deflater.h"
+
+class QWebSocketServer;
+class QWebSocket;
+class QTimer;
+class RPServer;
+
+// topic of the table occupancy pushes
+#define TOPIC_TABLES    "tables"
+
+// The websocket connections of one I/O event loop: handshakes, frames,
+// heartbeats, replies and pushes. Commands go to the server's shared
+// worker pool and their replies come back to the shard owning the socket.
+class ConnectionShard : public QObject
+{
+    Q_OBJECT
+
+public:
+    ConnectionShard(RPServer *server, int index);
+
+public Q_SLOTS:
+    void start();
+    void addConnection(qintptr descriptor);
+    void sendResponse(QWebSocket *pSocket, quint64 connectionId, const QByteArray &result);
+    void setTopics(QWebSocket *pSocket, quint64 connectionId, const QStringList &topics, const QJsonValue &reqId);
+    void publishTables(const QVariantMap &body);
+
+private Q_SLOTS:
+    void onNewConnection();
+    void processTextMessage(QString message);
+    void processBinaryMessage(QByteArray message);
+    void socketDisconnected();
+    void onPong();
+    void checkConnections();
+
+private:
+    struct Connection {
+        Connection() : id(0), protocol(Request::Json), lastSeen(0), resync(false) {}
+
+        quint64 id;
+        Request::Protocol protocol;
+        QSet<QString> topics;
+        QSharedPointer<Deflater> deflater;
+        qint64 lastSeen;
+        bool resync;
+    };
+
+    RPServer *server_;
+    int index_;
+    QWebSocketServer *webSocketServer_;
+    QTimer *heartbeatTimer_;
+    QElapsedTimer clock_;
+    quint64 nextConnectionId_;
+
+    QHash<QWebSocket *, Connection> connections_;
+
+    void addLogDebug(const QString &text);
+    void addLogInfo(const QString &text);
+    void addLogError(const QString &text);
+
+    Connection *find(QWebSocket *pSocket, quint64 connectionId);
+    void touch(QWebSocket *pSocket);
+    void queueCommand(QWebSocket *pSocket, const QByteArray &message);
+    bool writeMessage(QWebSocket *pSocket, const Connection &connection, const QByteArray &message);
+};
+
+// Accepts the TCP connections on the server port and hands them to the
+// shards in turn, each is upgraded on its shard's thread.
+class ConnectionAcceptor : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    explicit ConnectionAcceptor(const QList<ConnectionShard *> &shards, QObject *parent = 0);
+
+protected:
+    void incomingConnection(qintptr descriptor);
+
+private:
+    QList<ConnectionShard *> shards_;
+    int next_;
+};
+
+#endif // CONNECTIONSHARD_H
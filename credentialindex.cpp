@@ -0,0 +1,68 @@
+#include <QCryptographicHash>
+#include <QRandomGenerator>
+
+#include "credentialindex.h"
+#include "api.h"
+
+static const int SALT_SIZE = 16;
+
+CredentialIndex::CredentialIndex(QObject *parent) : QObject(parent),
+    generation_(1)
+{
+    salt_.resize(SALT_SIZE);
+    QRandomGenerator::system()->fillRange(reinterpret_cast<quint32 *>(salt_.data()), SALT_SIZE / sizeof(quint32));
+}
+
+QByteArray CredentialIndex::key(const QString &password) const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+
+    hash.addData(salt_);
+    hash.addData(password.toUtf8());
+
+    return hash.result();
+}
+
+bool CredentialIndex::find(const QByteArray &key, QVariantMap &people) const
+{
+    QReadLocker locker(&lock_);
+    QHash<QByteArray, QVariantMap>::const_iterator it = peoples_.constFind(key);
+
+    if (it == peoples_.constEnd())
+        return false;
+
+    people = it.value();
+    return true;
+}
+
+quint64 CredentialIndex::generation() const
+{
+    QReadLocker locker(&lock_);
+
+    return generation_;
+}
+
+void CredentialIndex::insert(const QByteArray &key, quint64 generation, const QVariantMap &people)
+{
+    QWriteLocker locker(&lock_);
+
+    // the people catalog changed while the login was being checked
+    if (generation != generation_)
+        return;
+
+    peoples_.insert(key, people);
+}
+
+void CredentialIndex::clear()
+{
+    QWriteLocker locker(&lock_);
+
+    generation_++;
+    peoples_.clear();
+}
+
+void CredentialIndex::onCatalogInvalidated(const QString &cmd)
+{
+    if (cmd.isEmpty() == true || cmd == COMMAND::CMD_GET_PEOPLES)
+        clear();
+}
@@ -0,0 +1,38 @@
+#ifndef CREDENTIALINDEX_H
+#define CREDENTIALINDEX_H
+
+#include <QObject>
+#include <QHash>
+#include <QVariant>
+#include <QReadWriteLock>
+
+// Login results keyed by a salted SHA-256 of the password, so no password
+// is held in memory. The salt is random for every server run. Filled by
+// logins that reached the database and dropped whenever the people
+// catalog changes.
+class CredentialIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CredentialIndex(QObject *parent = 0);
+
+    QByteArray key(const QString &password) const;
+
+    bool find(const QByteArray &key, QVariantMap &people) const;
+    quint64 generation() const;
+    void insert(const QByteArray &key, quint64 generation, const QVariantMap &people);
+
+public Q_SLOTS:
+    void clear();
+    void onCatalogInvalidated(const QString &cmd);
+
+private:
+    QByteArray salt_;
+
+    mutable QReadWriteLock lock_;
+    quint64 generation_;
+    QHash<QByteArray, QVariantMap> peoples_;
+};
+
+#endif // CREDENTIALINDEX_H
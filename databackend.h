@@ -0,0 +1,54 @@
+#ifndef DATABACKEND_H
+#define DATABACKEND_H
+
+#include <QVariant>
+
+// Data the server reads for its commands and the orders it writes. One
+// instance per thread, each with its own connection. The production
+// backend is the Firebird DataManager, stand-ins let the server run
+// without a database.
+class DataBackend
+{
+public:
+    virtual ~DataBackend() {}
+
+    virtual bool connect(const QString &dbName, const QString &user, const QString &password, QString &errText) = 0;
+    // Called before every command, reconnects a backend that lost its
+    // database. errText is only set when a reconnect was tried and failed.
+    virtual bool check(QString &errText) = 0;
+    // Asks the database itself whether it can be reached, after a write
+    // failed, to tell a database away from one refusing what was sent.
+    virtual bool ping(QString &errText) = 0;
+
+    virtual QVariantMap getPeople(const QString &password) = 0;
+    virtual QVariantList getPeoples() = 0;
+    virtual QVariantList getItemsGroups() = 0;
+    virtual QVariantList getItems() = 0;
+    virtual QVariantList getTables() = 0;
+    virtual QVariantList getTableBusy() = 0;
+    // The rights columns of a user profile as "forms", "opers", "pays"
+    // and "reports" JSON text, empty when there is no such profile.
+    virtual QVariantMap getProfile(const QVariant &profileId) = 0;
+
+    // Writes a batch of orders in one transaction, a new order when an
+    // order has a "table_id", otherwise lines added to the order of its
+    // "order_id" or "order_key". Every order gets its "order_id" and
+    // "line_ids" back in results, at the same position. False when
+    // nothing was written. Writing an order again under the same
+    // "write_key" and "order_key" changes nothing.
+    virtual bool writeOrders(const QVariantList &orders, QVariantList &results, QString &errText) = 0;
+};
+
+// Makes the backend of every thread, called from any thread.
+class DataBackendFactory
+{
+public:
+    virtual ~DataBackendFactory() {}
+
+    virtual DataBackend *create() const = 0;
+    // True when the catalogs never change, so the caches stay fresh
+    // without the database events.
+    virtual bool fixedCatalogs() const { return false; }
+};
+
+#endif // DATABACKEND_H
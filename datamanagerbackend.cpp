@@ -0,0 +1,247 @@
+#include <QSqlError>
+
+#include "datamanagerbackend.h"
+#include "datamanager.h"
+#include "dbconnection.h"
+
+// pause between two reconnect attempts of a backend, ms
+static const qint64 RECONNECT_INTERVAL = 5000;
+
+// new order (key, table, waiter, guests) returning its id, and one line
+// (key, order id or null, order key, item, quantity, price, comment)
+// returning the line id
+#define ADD_ORDER_SQL       "EXECUTE PROCEDURE RP_ADD_ORDER(?, ?, ?, ?)"
+#define ADD_ORDER_LINE_SQL  "EXECUTE PROCEDURE RP_ADD_ORDER_LINE(?, ?, ?, ?, ?, ?, ?)"
+
+#define PROFILE_SQL         "SELECT FORMS_PROFILE, OPERS_PROFILE, PAYS_PROFILE, REPORTS_PROFILE " \
+                            "FROM USERS_PROFILE WHERE ID = ?"
+
+DataManagerBackend::DataManagerBackend() :
+    dataManager_(new DataManager()),
+    connected_(false),
+    suspect_(false)
+{
+}
+
+DataManagerBackend::~DataManagerBackend()
+{
+}
+
+bool DataManagerBackend::connect(const QString &dbName, const QString &user, const QString &password, QString &errText)
+{
+    dbName_ = dbName;
+    user_ = user;
+    password_ = password;
+    lastAttempt_.start();
+    suspect_ = false;
+    // opened again with the DataManager, a later reopen means the
+    // database went away in between
+    connection_.reset();
+    connected_ = dataManager_->connect(dbName, user, password, errText);
+
+    return connected_;
+}
+
+bool DataManagerBackend::check(QString &errText)
+{
+    if (connected_ == true) {
+        if (suspect_ == false)
+            return true;
+
+        // the empty read may have been a lost connection
+        suspect_ = false;
+        if (ping(errText) == true && connection_->generation() == 1)
+            return true;
+
+        connected_ = false;
+        lastAttempt_.invalidate();
+    }
+
+    if (lastAttempt_.isValid() == true && lastAttempt_.elapsed() < RECONNECT_INTERVAL)
+        return false;
+
+    dataManager_.reset(new DataManager());
+
+    return connect(dbName_, user_, password_, errText);
+}
+
+// The backend's own connection answers for the database, a failed probe
+// reopens it.
+bool DataManagerBackend::ping(QString &errText)
+{
+    if (!connection_)
+        return connection(errText) != 0;
+
+    return connection_->probe(errText);
+}
+
+// A wrong password finds no one, an empty result says nothing here.
+QVariantMap DataManagerBackend::getPeople(const QString &password)
+{
+    return dataManager_->getPeople(password);
+}
+
+QVariantList DataManagerBackend::getPeoples()
+{
+    return checked(dataManager_->getPeoples());
+}
+
+QVariantList DataManagerBackend::getItemsGroups()
+{
+    return checked(dataManager_->getItemsGroups());
+}
+
+QVariantList DataManagerBackend::getItems()
+{
+    return checked(dataManager_->getItems());
+}
+
+QVariantList DataManagerBackend::getTables()
+{
+    return checked(dataManager_->getTables());
+}
+
+// no table may be busy
+QVariantList DataManagerBackend::getTableBusy()
+{
+    return dataManager_->getTableBusy();
+}
+
+// DataManager doesn't report failed queries. A catalog is never empty,
+// an empty one is probed by the next check.
+QVariantList DataManagerBackend::checked(const QVariantList &rows)
+{
+    suspect_ = rows.isEmpty();
+    return rows;
+}
+
+QVariantMap DataManagerBackend::getProfile(const QVariant &profileId)
+{
+    QVariantMap profile;
+    QString errText;
+    DbConnection *db = connection(errText);
+    QSqlQuery *query = db ? db->prepared(PROFILE_SQL) : 0;
+
+    if (!query)
+        return profile;
+
+    query->bindValue(0, profileId);
+    if (query->exec() == false)
+        db->invalidate();
+    else if (query->next() == true) {
+        profile["forms"] = query->value(0);
+        profile["opers"] = query->value(1);
+        profile["pays"] = query->value(2);
+        profile["reports"] = query->value(3);
+    }
+    query->finish();
+
+    return profile;
+}
+
+// The backend's own connection, opened on first use and reopened after
+// a failure. 0 while the database can't be reached.
+DbConnection *DataManagerBackend::connection(QString &errText)
+{
+    if (!connection_) {
+        connection_.reset(new DbConnection(dbName_, user_, password_));
+        if (connection_->open(errText) == false)
+            return 0;
+    }
+    else if (connection_->check(errText) == false)
+        return 0;
+
+    return connection_.data();
+}
+
+// Runs one procedure returning an id, the statement is left finished.
+static bool executeReturningId(QSqlQuery *query, const QVariantList &values, QVariant &id, QString &errText)
+{
+    if (!query) {
+        errText = "statement failed to prepare";
+        return false;
+    }
+
+    for (int x = 0; x < values.size(); ++x)
+        query->bindValue(x, values[x]);
+
+    if (query->exec() == false || query->next() == false) {
+        errText = query->lastError().text();
+        query->finish();
+        return false;
+    }
+
+    id = query->value(0);
+    query->finish();
+
+    return true;
+}
+
+bool DataManagerBackend::writeOrders(const QVariantList &orders, QVariantList &results, QString &errText)
+{
+    DbConnection *writer = connection(errText);
+    QSqlDatabase db;
+
+    if (!writer)
+        return false;
+
+    db = writer->database();
+    if (db.transaction() == false) {
+        errText = db.lastError().text();
+        writer->invalidate();
+        return false;
+    }
+
+    results.clear();
+    foreach (const QVariant &value, orders) {
+        QVariantMap order = value.toMap();
+        QVariantMap result;
+        QVariantList lineIds;
+        QVariantList lines = order.value("lines").toList();
+        QVariant orderId = order.value("order_id");
+        QString writeKey = order.value("write_key").toString();
+        bool ok = true;
+
+        if (order.contains("table_id") == true)
+            ok = executeReturningId(writer->prepared(ADD_ORDER_SQL),
+                                    QVariantList() << order.value("order_key") << order.value("table_id")
+                                                   << order.value("people_id") << order.value("guests"),
+                                    orderId, errText);
+
+        // a line's key is the key of its write and its position in it
+        for (int x = 0; x < lines.size() && ok == true; ++x) {
+            QVariantMap line = lines[x].toMap();
+            QVariant lineId;
+
+            ok = executeReturningId(writer->prepared(ADD_ORDER_LINE_SQL),
+                                    QVariantList() << QString("%1/%2").arg(writeKey).arg(x) << orderId
+                                                   << order.value("order_key") << line.value("item_id")
+                                                   << line.value("quantity") << line.value("price")
+                                                   << line.value("comment"),
+                                    lineId, errText);
+            lineIds << lineId;
+        }
+
+        // the next write reopens the connection, it may be what failed
+        if (ok == false) {
+            db.rollback();
+            writer->invalidate();
+            results.clear();
+            return false;
+        }
+
+        result["order_id"] = orderId;
+        result["line_ids"] = lineIds;
+        results << result;
+    }
+
+    if (db.commit() == false) {
+        errText = db.lastError().text();
+        db.rollback();
+        writer->invalidate();
+        results.clear();
+        return false;
+    }
+
+    return true;
+}
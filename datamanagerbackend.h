@@ -0,0 +1,63 @@
+#ifndef DATAMANAGERBACKEND_H
+#define DATAMANAGERBACKEND_H
+
+#include <QScopedPointer>
+#include <QElapsedTimer>
+
+#include "databackend.h"
+
+class DataManager;
+class DbConnection;
+
+// The Firebird database through DataManager. A backend that failed to
+// connect tries again on the next command, at most every few seconds.
+// A catalog that came back empty makes the next check probe the
+// database, and a DataManager whose database went away since it
+// connected is connected again.
+// Profiles are read and orders written on a connection of its own,
+// opened on first use. Orders go through the RP_ADD_ORDER and
+// RP_ADD_ORDER_LINE procedures. Both take the key of what they write and
+// must do nothing but return the existing id for a key they have seen
+// (UPDATE OR INSERT ... MATCHING), so a replayed order is never written
+// twice.
+class DataManagerBackend : public DataBackend
+{
+public:
+    DataManagerBackend();
+    ~DataManagerBackend();
+
+    bool connect(const QString &dbName, const QString &user, const QString &password, QString &errText);
+    bool check(QString &errText);
+    bool ping(QString &errText);
+
+    QVariantMap getPeople(const QString &password);
+    QVariantList getPeoples();
+    QVariantList getItemsGroups();
+    QVariantList getItems();
+    QVariantList getTables();
+    QVariantList getTableBusy();
+    QVariantMap getProfile(const QVariant &profileId);
+
+    bool writeOrders(const QVariantList &orders, QVariantList &results, QString &errText);
+
+private:
+    QScopedPointer<DataManager> dataManager_;
+    QScopedPointer<DbConnection> connection_;
+    QString dbName_;
+    QString user_;
+    QString password_;
+    bool connected_;
+    bool suspect_;
+    QElapsedTimer lastAttempt_;
+
+    DbConnection *connection(QString &errText);
+    QVariantList checked(const QVariantList &rows);
+};
+
+class DataManagerBackendFactory : public DataBackendFactory
+{
+public:
+    DataBackend *create() const { return new DataManagerBackend(); }
+};
+
+#endif // DATAMANAGERBACKEND_H
@@ -0,0 +1,120 @@
+#include <QSqlError>
+#include <QAtomicInt>
+
+#include "dbconnection.h"
+
+// a connection unused for longer is probed before use, ms
+static const qint64 HEALTH_CHECK_IDLE = 30000;
+
+#define HEALTH_CHECK_SQL    "SELECT 1 FROM RDB$DATABASE"
+
+// numbers the connection names, every connection needs its own
+static QAtomicInt connectionCounter;
+
+DbConnection::DbConnection(const QString &dbName, const QString &user, const QString &password) :
+    name_(QString("rp_db_%1").arg(connectionCounter.fetchAndAddOrdered(1))),
+    dbName_(dbName),
+    user_(user),
+    password_(password),
+    broken_(false),
+    generation_(0)
+{
+}
+
+DbConnection::~DbConnection()
+{
+    close();
+}
+
+bool DbConnection::open(QString &errText)
+{
+    QSqlDatabase db = QSqlDatabase::addDatabase("QIBASE", name_);
+
+    db.setDatabaseName(dbName_);
+    db.setUserName(user_);
+    db.setPassword(password_);
+
+    if (db.open() == false) {
+        errText = db.lastError().text();
+        broken_ = true;
+        return false;
+    }
+
+    broken_ = false;
+    ++generation_;
+    lastUsed_.start();
+
+    return true;
+}
+
+// Probes a connection idle for too long and reopens a broken one. The
+// prepared statements die with the old connection and are prepared again
+// on first use.
+bool DbConnection::check(QString &errText)
+{
+    if (broken_ == false && lastUsed_.isValid() == true && lastUsed_.elapsed() < HEALTH_CHECK_IDLE)
+        return true;
+
+    return probe(errText);
+}
+
+// Runs the probe query however recently the connection was used, and
+// reopens the connection when it fails. False when the database can't
+// be reached.
+bool DbConnection::probe(QString &errText)
+{
+    if (broken_ == false) {
+        QSqlQuery *query = prepared(HEALTH_CHECK_SQL);
+
+        if (query && query->exec() == true) {
+            query->finish();
+            return true;
+        }
+    }
+
+    close();
+    return open(errText);
+}
+
+// Called after a query failed on a lost connection, the next check
+// reopens it.
+void DbConnection::invalidate()
+{
+    broken_ = true;
+}
+
+QSqlDatabase DbConnection::database() const
+{
+    return QSqlDatabase::database(name_, false);
+}
+
+// The statement prepared for this text on this connection, 0 when it
+// fails to prepare. Call finish() on it once the rows are read.
+QSqlQuery *DbConnection::prepared(const QString &sql)
+{
+    QHash<QString, QSqlQuery>::iterator it = statements_.find(sql);
+
+    lastUsed_.start();
+
+    if (it == statements_.end()) {
+        QSqlQuery query(database());
+
+        query.setForwardOnly(true);
+        if (query.prepare(sql) == false)
+            return 0;
+
+        it = statements_.insert(sql, query);
+    }
+
+    return &it.value();
+}
+
+void DbConnection::close()
+{
+    statements_.clear();
+
+    if (QSqlDatabase::contains(name_) == true) {
+        database().close();
+        QSqlDatabase::removeDatabase(name_);
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef DBCONNECTION_H
+#define DBCONNECTION_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QHash>
+#include <QElapsedTimer>
+
+// One Firebird connection for the thread that opened it, Qt connections
+// can't move between threads. Statements are prepared once and kept for
+// the life of the connection, so only the first call of a query pays for
+// parsing and planning. A connection idle for a while is probed before
+// use and reopened when the probe or a query has failed.
+class DbConnection
+{
+public:
+    DbConnection(const QString &dbName, const QString &user, const QString &password);
+    ~DbConnection();
+
+    bool open(QString &errText);
+    bool check(QString &errText);
+    bool probe(QString &errText);
+    void invalidate();
+    int generation() const { return generation_; }
+
+    QSqlDatabase database() const;
+    QSqlQuery *prepared(const QString &sql);
+
+private:
+    QString name_;
+    QString dbName_;
+    QString user_;
+    QString password_;
+
+    QHash<QString, QSqlQuery> statements_;
+    QElapsedTimer lastUsed_;
+    bool broken_;
+    int generation_;
+
+    void close();
+};
+
+#endif // DBCONNECTION_H
@@ -0,0 +1,143 @@
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+
+#include "dbeventlistener.h"
+#include "dbconnection.h"
+
+DbEventListener::DbEventListener(const QString &dbName, const QString &user, const QString &password,
+                                 QObject *parent) : QObject(parent),
+    connection_(new DbConnection(dbName, user, password)),
+    generation_(-1),
+    pollInterval_(0),
+    notifying_(false),
+    lost_(false)
+{
+    connect(&pollTimer_, &QTimer::timeout, this, &DbEventListener::pollGeneration);
+    connect(&healthTimer_, &QTimer::timeout, this, &DbEventListener::checkConnection);
+}
+
+DbEventListener::~DbEventListener()
+{
+    pollTimer_.stop();
+    healthTimer_.stop();
+}
+
+bool DbEventListener::start(const QStringList &events, const QString &generator, int pollInterval, QString &errText)
+{
+    events_ = events;
+    generator_ = generator;
+    pollInterval_ = pollInterval;
+
+    if (connection_->open(errText) == false)
+        return false;
+
+    return subscribe(errText);
+}
+
+// Registers the events on the current connection, the notifications of a
+// closed connection are gone with it.
+bool DbEventListener::subscribe(QString &errText)
+{
+    QSqlDatabase db = connection_->database();
+    bool subscribed = true;
+    bool ok;
+
+    if (db.driver()->hasFeature(QSqlDriver::EventNotifications) == true) {
+        connect(db.driver(),
+                static_cast<void (QSqlDriver::*)(const QString &, QSqlDriver::NotificationSource, const QVariant &)>(&QSqlDriver::notification),
+                this, &DbEventListener::onNotification);
+
+        foreach (const QString &event, events_)
+            subscribed = db.driver()->subscribeToNotification(event) && subscribed;
+    }
+    else
+        subscribed = false;
+
+    // the generation counter covers events that failed to register
+    notifying_ = subscribed;
+    if (subscribed == true) {
+        pollTimer_.stop();
+        healthTimer_.start(pollInterval_ * 1000);
+    }
+    else if (generator_.isEmpty() == false) {
+        healthTimer_.stop();
+        generation_ = readGeneration(ok);
+        if (ok == false) {
+            errText = db.lastError().text();
+            return false;
+        }
+        pollTimer_.start(pollInterval_ * 1000);
+    }
+
+    return true;
+}
+
+void DbEventListener::onNotification(const QString &name, QSqlDriver::NotificationSource source, const QVariant &payload)
+{
+    Q_UNUSED(source);
+    Q_UNUSED(payload);
+
+    Q_EMIT eventPosted(name);
+}
+
+// Notifications stop without a word when the database goes away. The
+// probe reopens the connection, a new connection gets the events again.
+void DbEventListener::checkConnection()
+{
+    QString errText;
+    int generation = connection_->generation();
+
+    if (connection_->probe(errText) == true && connection_->generation() == generation)
+        return;
+
+    if (errText.isEmpty() == true && subscribe(errText) == true) {
+        lost_ = false;
+        Q_EMIT resubscribed();
+        return;
+    }
+
+    // tried again on the next check
+    connection_->invalidate();
+    if (lost_ == false) {
+        lost_ = true;
+        Q_EMIT connectionLost(errText);
+    }
+}
+
+// A lost connection is reopened on the next poll, a change made while it
+// was down still shows up as a new generation.
+void DbEventListener::pollGeneration()
+{
+    QString errText;
+    qint64 generation;
+    bool ok;
+
+    if (connection_->check(errText) == false)
+        return;
+
+    generation = readGeneration(ok);
+    if (ok == false) {
+        connection_->invalidate();
+        return;
+    }
+
+    if (generation != generation_) {
+        generation_ = generation;
+        Q_EMIT eventPosted(QString());
+    }
+}
+
+qint64 DbEventListener::readGeneration(bool &ok)
+{
+    QSqlQuery *query = connection_->prepared(QString("SELECT GEN_ID(%1, 0) FROM RDB$DATABASE").arg(generator_));
+    qint64 generation = -1;
+
+    ok = query && query->exec() && query->next();
+    if (ok == true)
+        generation = query->value(0).toLongLong();
+    if (query)
+        query->finish();
+
+    return generation;
+}
@@ -0,0 +1,57 @@
+#ifndef DBEVENTLISTENER_H
+#define DBEVENTLISTENER_H
+
+#include <QObject>
+#include <QStringList>
+#include <QSqlDriver>
+#include <QTimer>
+#include <QScopedPointer>
+
+class DbConnection;
+
+// Listens for Firebird POST_EVENT notifications on its own connection.
+// When the events can't be registered it falls back to polling a
+// generation counter and reports any change as an event with empty name.
+// A silent notification connection is probed on the same interval: a
+// failed probe is reported as lost, and once the connection is reopened
+// the events are registered again and reported as resubscribed.
+class DbEventListener : public QObject
+{
+    Q_OBJECT
+
+public:
+    DbEventListener(const QString &dbName, const QString &user, const QString &password,
+                    QObject *parent = 0);
+    ~DbEventListener();
+
+    bool start(const QStringList &events, const QString &generator, int pollInterval, QString &errText);
+    // True when every event was registered, false while polling.
+    bool notifying() const { return notifying_; }
+
+Q_SIGNALS:
+    void eventPosted(const QString &name);
+    // Events may have been missed from here on, until resubscribed.
+    void connectionLost(const QString &errText);
+    void resubscribed();
+
+private Q_SLOTS:
+    void onNotification(const QString &name, QSqlDriver::NotificationSource source, const QVariant &payload);
+    void pollGeneration();
+    void checkConnection();
+
+private:
+    QScopedPointer<DbConnection> connection_;
+    QStringList events_;
+    QString generator_;
+    qint64 generation_;
+    int pollInterval_;
+    bool notifying_;
+    bool lost_;
+    QTimer pollTimer_;
+    QTimer healthTimer_;
+
+    bool subscribe(QString &errText);
+    qint64 readGeneration(bool &ok);
+};
+
+#endif // DBEVENTLISTENER_H
@@ -0,0 +1,54 @@
+#include <cstring>
+
+#include "deflater.h"
+
+// bytes closing every sync flush, dropped as in RFC 7692
+static const char SYNC_TAIL[] = { '\x00', '\x00', '\xff', '\xff' };
+
+Deflater::Deflater(int level)
+{
+    stream_.zalloc = Z_NULL;
+    stream_.zfree = Z_NULL;
+    stream_.opaque = Z_NULL;
+
+    valid_ = deflateInit2(&stream_, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+}
+
+Deflater::~Deflater()
+{
+    if (valid_ == true)
+        deflateEnd(&stream_);
+}
+
+QByteArray Deflater::compress(const QByteArray &data)
+{
+    QByteArray result;
+    int size = 0;
+
+    if (valid_ == false)
+        return result;
+
+    result.resize(int(deflateBound(&stream_, data.size())) + 16);
+    stream_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+    stream_.avail_in = data.size();
+
+    do {
+        if (size == result.size())
+            result.resize(result.size() * 2);
+
+        stream_.next_out = reinterpret_cast<Bytef *>(result.data() + size);
+        stream_.avail_out = result.size() - size;
+
+        if (deflate(&stream_, Z_SYNC_FLUSH) == Z_STREAM_ERROR) {
+            valid_ = false;
+            return QByteArray();
+        }
+        size = result.size() - stream_.avail_out;
+    } while (stream_.avail_out == 0);
+
+    if (size >= 4 && memcmp(result.constData() + size - 4, SYNC_TAIL, 4) == 0)
+        size -= 4;
+    result.resize(size);
+
+    return result;
+}
@@ -0,0 +1,28 @@
+#ifndef DEFLATER_H
+#define DEFLATER_H
+
+#include <QByteArray>
+
+#include <zlib.h>
+
+// Raw deflate stream kept open for the whole connection, the same way as
+// permessage-deflate with context takeover: each message is ended with a
+// sync flush, so later messages reuse the window of the earlier ones. The
+// client inflates every compressed message with one inflater in order.
+class Deflater
+{
+public:
+    explicit Deflater(int level = Z_DEFAULT_COMPRESSION);
+    ~Deflater();
+
+    bool isValid() const { return valid_; }
+    QByteArray compress(const QByteArray &data);
+
+private:
+    z_stream stream_;
+    bool valid_;
+
+    Q_DISABLE_COPY(Deflater)
+};
+
+#endif // DEFLATER_H
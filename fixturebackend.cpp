@@ -0,0 +1,181 @@
+#include <QThread>
+#include <QDateTime>
+#include <QAtomicInteger>
+
+#include "fixturebackend.h"
+
+// first fixture password, waiter i has FIRST_PASSWORD + i
+static const int FIRST_PASSWORD = 1000;
+// the occupancy changes this often, s
+static const int BUSY_PERIOD = 10;
+
+// ids handed out to written orders and lines, shared by every backend
+static QAtomicInteger<qint64> lastOrderId;
+static QAtomicInteger<qint64> lastLineId;
+
+FixtureBackend::FixtureBackend(const Data &data, int delayMs) :
+    data_(data),
+    delayMs_(delayMs)
+{
+}
+
+bool FixtureBackend::connect(const QString &dbName, const QString &user, const QString &password, QString &errText)
+{
+    Q_UNUSED(dbName);
+    Q_UNUSED(user);
+    Q_UNUSED(password);
+    Q_UNUSED(errText);
+
+    return true;
+}
+
+QVariantMap FixtureBackend::getPeople(const QString &password)
+{
+    int index = password.toInt() - FIRST_PASSWORD;
+
+    wait();
+    if (index < 0 || index >= data_.peoples.size())
+        return QVariantMap();
+
+    return data_.peoples[index].toMap();
+}
+
+QVariantList FixtureBackend::getPeoples()
+{
+    wait();
+    return data_.peoples;
+}
+
+QVariantList FixtureBackend::getItemsGroups()
+{
+    wait();
+    return data_.groups;
+}
+
+QVariantList FixtureBackend::getItems()
+{
+    wait();
+    return data_.items;
+}
+
+QVariantList FixtureBackend::getTables()
+{
+    wait();
+    return data_.tables;
+}
+
+QVariantList FixtureBackend::getTableBusy()
+{
+    qint64 period = QDateTime::currentMSecsSinceEpoch() / 1000 / BUSY_PERIOD;
+    QVariantList busy;
+
+    wait();
+    for (int x = 0; x < data_.tables.size(); ++x) {
+        if ((x + period) % 3 != 0)
+            continue;
+
+        QVariantMap table;
+
+        table["id"] = data_.tables[x].toMap().value("id");
+        table["people_id"] = data_.peoples.isEmpty() ? QVariant() : data_.peoples[x % data_.peoples.size()].toMap().value("id");
+        table["guests"] = 1 + x % 4;
+        busy << table;
+    }
+
+    return busy;
+}
+
+QVariantMap FixtureBackend::getProfile(const QVariant &profileId)
+{
+    QVariantMap profile;
+
+    wait();
+    if (profileId.toInt() == 1) {
+        profile["forms"] = "{}";
+        profile["opers"] = "{}";
+        profile["pays"] = "{}";
+        profile["reports"] = "{}";
+    }
+
+    return profile;
+}
+
+// One delay for the whole batch, as one transaction would take.
+bool FixtureBackend::writeOrders(const QVariantList &orders, QVariantList &results, QString &errText)
+{
+    Q_UNUSED(errText);
+
+    wait();
+    results.clear();
+    foreach (const QVariant &value, orders) {
+        QVariantMap order = value.toMap();
+        QVariantMap result;
+        QVariantList lineIds;
+
+        result["order_id"] = order.contains("table_id") ? lastOrderId.fetchAndAddOrdered(1) + 1
+                                                        : order.value("order_id").toLongLong();
+        foreach (const QVariant &line, order.value("lines").toList()) {
+            Q_UNUSED(line);
+            lineIds << lastLineId.fetchAndAddOrdered(1) + 1;
+        }
+        result["line_ids"] = lineIds;
+        results << result;
+    }
+
+    return true;
+}
+
+void FixtureBackend::wait() const
+{
+    if (delayMs_ > 0)
+        QThread::msleep(delayMs_);
+}
+
+//=============================================================================
+// class FixtureBackendFactory
+//=============================================================================
+FixtureBackendFactory::FixtureBackendFactory(int peoples, int groups, int items, int tables, int delayMs) :
+    delayMs_(delayMs)
+{
+    for (int x = 0; x < peoples; ++x) {
+        QVariantMap row;
+
+        row["id"] = x + 1;
+        row["name"] = QString("Waiter %1").arg(x + 1);
+        row["profile_id"] = 1;
+        data_.peoples << row;
+    }
+
+    for (int x = 0; x < groups; ++x) {
+        QVariantMap row;
+
+        row["id"] = x + 1;
+        row["parent_id"] = x < 4 ? 0 : 1 + x % 4;
+        row["name"] = QString("Group %1").arg(x + 1);
+        data_.groups << row;
+    }
+
+    for (int x = 0; x < items; ++x) {
+        QVariantMap row;
+
+        row["id"] = x + 1;
+        row["group_id"] = groups > 0 ? 1 + x % groups : 0;
+        row["name"] = QString("Item %1").arg(x + 1);
+        row["price"] = 100 + (x * 37) % 900;
+        data_.items << row;
+    }
+
+    for (int x = 0; x < tables; ++x) {
+        QVariantMap row;
+
+        row["id"] = x + 1;
+        row["name"] = QString::number(x + 1);
+        row["hall"] = 1 + x / 20;
+        data_.tables << row;
+    }
+}
+
+DataBackend *FixtureBackendFactory::create() const
+{
+    return new FixtureBackend(data_, delayMs_);
+}
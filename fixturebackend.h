@@ -0,0 +1,58 @@
+#ifndef FIXTUREBACKEND_H
+#define FIXTUREBACKEND_H
+
+#include "databackend.h"
+
+// Generated catalogs held in memory, for load tests without a Firebird
+// install. Waiter i logs in with password 1000 + i. A fixed delay can be
+// added to every call to stand in for the database round trip. The
+// occupancy changes every few seconds so the table pushes have work.
+// Orders are only numbered, nothing is kept. Every profile has the
+// default rights.
+class FixtureBackend : public DataBackend
+{
+public:
+    struct Data {
+        QVariantList peoples;
+        QVariantList groups;
+        QVariantList items;
+        QVariantList tables;
+    };
+
+    FixtureBackend(const Data &data, int delayMs);
+
+    bool connect(const QString &dbName, const QString &user, const QString &password, QString &errText);
+    bool check(QString &errText) { Q_UNUSED(errText); return true; }
+    bool ping(QString &errText) { Q_UNUSED(errText); return true; }
+
+    QVariantMap getPeople(const QString &password);
+    QVariantList getPeoples();
+    QVariantList getItemsGroups();
+    QVariantList getItems();
+    QVariantList getTables();
+    QVariantList getTableBusy();
+    QVariantMap getProfile(const QVariant &profileId);
+
+    bool writeOrders(const QVariantList &orders, QVariantList &results, QString &errText);
+
+private:
+    Data data_;
+    int delayMs_;
+
+    void wait() const;
+};
+
+class FixtureBackendFactory : public DataBackendFactory
+{
+public:
+    FixtureBackendFactory(int peoples, int groups, int items, int tables, int delayMs);
+
+    DataBackend *create() const;
+    bool fixedCatalogs() const { return true; }
+
+private:
+    FixtureBackend::Data data_;
+    int delayMs_;
+};
+
+#endif // FIXTUREBACKEND_H
@@ -0,0 +1,121 @@
+#include <QKeyEvent>
+#include <QKeySequence>
+
+#include "hotkeyindex.h"
+#include "defines.h"
+#include "function.h"
+
+// kMap - ID действия -> клавиши через ", ", как в HOTKEYS_PROFILE.
+// Действия, которых нет в kMap, получают клавиши по умолчанию.
+void GHotKeyIndex::compile( const QVariantMap &kMap )
+{
+    clear();
+    groups_.resize( gHotKeyGroupList.count() );
+
+    for ( int x = 0; x < gHotKeyGroupList.count(); ++x ) {
+        GHotKeyGroup *group = gHotKeyGroupList[ x ];
+        Group &index = groups_[ x ];
+
+        for ( int y = 0; y < group->hKeys_.count(); ++y ) {
+            int id = group->hKeys_[ y ]->id_;
+            QString text;
+
+            if ( isHidden( id ) == true )
+                continue;
+
+            groupIds_[ id ] = x;
+            if ( kMap.contains( QString::number( id ) ) == true )
+                text = kMap[ QString::number( id ) ].toString();
+            else
+                text = findHotKey( id, true );
+
+            foreach( int key, parseKeys( text ) ) {
+                if ( index.actions.contains( key ) == false ) {
+                    index.actions[ key ] = id;
+                    continue;
+                }
+
+                if ( index.actions[ key ] == id || index.conflicts.value( key ).contains( id ) == true )
+                    continue;
+
+                // одно сочетание у нескольких действий группы
+                if ( index.conflicts.contains( key ) == false ) {
+                    index.conflicts[ key ] << index.actions[ key ];
+                    conflictIds_[ index.actions[ key ] ] << key;
+                }
+                index.conflicts[ key ] << id;
+                conflictIds_[ id ] << key;
+            }
+        }
+    }
+}
+
+void GHotKeyIndex::clear()
+{
+    groups_.clear();
+    groupIds_.clear();
+    conflictIds_.clear();
+}
+
+// действие группы group (номер в gHotKeyGroupList), -1 если его нет
+int GHotKeyIndex::action( int group, int key ) const
+{
+    if ( group < 0 || group >= groups_.count() )
+        return -1;
+
+    return groups_[ group ].actions.value( key, -1 );
+}
+
+// действия той же группы, с которыми id делит хотя бы одно сочетание
+QList< int > GHotKeyIndex::conflicts( int id ) const
+{
+    QList< int > idList;
+
+    if ( groupIds_.contains( id ) == false )
+        return idList;
+
+    foreach( int key, conflictIds_.value( id ) ) {
+        foreach( int other, groups_[ groupIds_[ id ] ].conflicts.value( key ) ) {
+            if ( other != id && idList.contains( other ) == false )
+                idList << other;
+        }
+    }
+
+    return idList;
+}
+
+// клавиша спец. продажи видна и действует только у пользователя 'developer'
+bool GHotKeyIndex::isHidden( int id )
+{
+    return id == SPECIAL_MODE_HKEY && gIdUser != -1;
+}
+
+int GHotKeyIndex::keyCode( QKeyEvent *e )
+{
+    int result = e->key();
+
+    if ( e->modifiers() & Qt::ControlModifier )
+        result += Qt::CTRL;
+    if ( e->modifiers() & Qt::AltModifier )
+        result += Qt::ALT;
+    if ( e->modifiers() & Qt::ShiftModifier )
+        result += Qt::SHIFT;
+    if ( e->modifiers() & Qt::MetaModifier )
+        result += Qt::META;
+
+    return result;
+}
+
+QList< int > GHotKeyIndex::parseKeys( const QString &text )
+{
+    QList< int > keyList;
+
+    foreach( const QString &key, text.split( ", ", Qt::SkipEmptyParts ) ) {
+        QKeySequence seq = QKeySequence::fromString( key, QKeySequence::PortableText );
+
+        if ( seq.isEmpty() == false && keyList.contains( seq[ 0 ] ) == false )
+            keyList << seq[ 0 ];
+    }
+
+    return keyList;
+}
@@ -0,0 +1,46 @@
+#ifndef HOTKEYINDEX_H
+#define HOTKEYINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <QVariant>
+
+class QKeyEvent;
+
+// Горячие клавиши профиля, собранные для каждой группы gHotKeyGroupList
+// в хэш "сочетание -> действие". Группа - это свой экран, одно сочетание
+// в разных группах не спор. Строится из gHotKeyGroupList и HOTKEYS_PROFILE
+// профиля один раз, нажатие клавиши ищется без перебора строк. Скрытые
+// клавиши в индекс не входят.
+class GHotKeyIndex
+{
+public:
+    GHotKeyIndex() {}
+
+    void compile( const QVariantMap &kMap );
+    void clear();
+
+    int action( int group, int key ) const;
+    int action( int group, QKeyEvent *e ) const { return action( group, keyCode( e ) ); }
+
+    bool hasConflicts() const { return conflictIds_.isEmpty() == false; }
+    bool isConflict( int id ) const { return conflictIds_.contains( id ); }
+    QList< int > conflicts( int id ) const;
+
+    static bool isHidden( int id );
+    static int keyCode( QKeyEvent *e );
+    static QList< int > parseKeys( const QString &text );
+
+private:
+    struct Group {
+        QHash< int, int > actions;              // сочетание -> ID действия
+        QHash< int, QList< int > > conflicts;   // сочетание -> все его действия
+    };
+
+    QVector< Group > groups_;
+    QHash< int, int > groupIds_;                // действие -> его группа
+    QHash< int, QList< int > > conflictIds_;    // действие -> его спорные сочетания
+};
+
+#endif // HOTKEYINDEX_H
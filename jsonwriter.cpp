@@ -0,0 +1,245 @@
+#include <QLocale>
+#include <qmath.h>
+
+#include "jsonwriter.h"
+
+// largest integer a double holds exactly, bigger ones are written as doubles
+static const double MAX_EXACT_INTEGER = 9007199254740992.0;
+
+JsonWriter::JsonWriter(QByteArray &buffer) :
+    buffer_(buffer),
+    afterKey_(false)
+{
+    // a reserved buffer keeps its capacity when resized to 0, Qt frees
+    // any other
+    buffer_.reserve(buffer_.capacity());
+    buffer_.resize(0);
+    first_.append(true);
+}
+
+void JsonWriter::separator()
+{
+    if (afterKey_ == true) {
+        afterKey_ = false;
+        return;
+    }
+
+    if (first_.last() == false)
+        buffer_.append(',');
+    first_.last() = false;
+}
+
+void JsonWriter::beginObject()
+{
+    separator();
+    buffer_.append('{');
+    first_.append(true);
+}
+
+void JsonWriter::endObject()
+{
+    first_.removeLast();
+    buffer_.append('}');
+}
+
+void JsonWriter::beginArray()
+{
+    separator();
+    buffer_.append('[');
+    first_.append(true);
+}
+
+void JsonWriter::endArray()
+{
+    first_.removeLast();
+    buffer_.append(']');
+}
+
+void JsonWriter::key(const QString &name)
+{
+    separator();
+    writeString(name);
+    buffer_.append(':');
+    afterKey_ = true;
+}
+
+void JsonWriter::key(const char *name)
+{
+    separator();
+    buffer_.append('"').append(name).append("\":");
+    afterKey_ = true;
+}
+
+void JsonWriter::value(const QVariant &value)
+{
+    switch (value.userType()) {
+    case QMetaType::UnknownType:
+    case QMetaType::Nullptr:
+        nullValue();
+        break;
+    case QMetaType::Bool:
+        this->value(value.toBool());
+        break;
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::Short:
+    case QMetaType::UShort:
+    case QMetaType::Long:
+    case QMetaType::LongLong:
+        this->value(value.toLongLong());
+        break;
+    case QMetaType::ULong:
+    case QMetaType::ULongLong:
+        if (value.toULongLong() <= quint64(MAX_EXACT_INTEGER))
+            this->value(value.toLongLong());
+        else
+            this->value(value.toDouble());
+        break;
+    case QMetaType::Float:
+    case QMetaType::Double:
+        this->value(value.toDouble());
+        break;
+    case QMetaType::QString:
+        this->value(value.toString());
+        break;
+    case QMetaType::QVariantMap:
+        writeMap(value.toMap());
+        break;
+    case QMetaType::QVariantHash: {
+        QVariantHash hash = value.toHash();
+
+        beginObject();
+        for (QVariantHash::const_iterator it = hash.constBegin(); it != hash.constEnd(); ++it) {
+            key(it.key());
+            this->value(it.value());
+        }
+        endObject();
+        break;
+    }
+    case QMetaType::QVariantList:
+    case QMetaType::QStringList:
+        writeRows(value.toList());
+        break;
+    default: {
+        // same as QJsonValue::fromVariant: text form, empty text is null
+        QString text = value.toString();
+
+        if (text.isEmpty() == true)
+            nullValue();
+        else
+            this->value(text);
+        break;
+    }
+    }
+}
+
+void JsonWriter::value(const QString &value)
+{
+    separator();
+    writeString(value);
+}
+
+void JsonWriter::value(qint64 value)
+{
+    separator();
+    buffer_.append(QByteArray::number(value));
+}
+
+void JsonWriter::value(double value)
+{
+    if (qIsFinite(value) == false) {
+        nullValue();
+        return;
+    }
+
+    separator();
+    if (value == std::floor(value) && std::fabs(value) < MAX_EXACT_INTEGER)
+        buffer_.append(QByteArray::number(qint64(value)));
+    else
+        buffer_.append(QByteArray::number(value, 'g', QLocale::FloatingPointShortest));
+}
+
+void JsonWriter::value(bool value)
+{
+    separator();
+    buffer_.append(value ? "true" : "false");
+}
+
+void JsonWriter::nullValue()
+{
+    separator();
+    buffer_.append("null");
+}
+
+void JsonWriter::writeMap(const QVariantMap &map)
+{
+    beginObject();
+    for (QVariantMap::const_iterator it = map.constBegin(); it != map.constEnd(); ++it) {
+        key(it.key());
+        value(it.value());
+    }
+    endObject();
+}
+
+void JsonWriter::writeRows(const QVariantList &rows)
+{
+    beginArray();
+    foreach (const QVariant &row, rows)
+        value(row);
+    endArray();
+}
+
+void JsonWriter::writeString(const QString &text)
+{
+    writeString(text.constData(), text.size());
+}
+
+void JsonWriter::writeString(const QChar *data, int size)
+{
+    static const char HEX[] = "0123456789abcdef";
+
+    buffer_.append('"');
+    for (int x = 0; x < size; ++x) {
+        ushort ch = data[x].unicode();
+
+        if (ch < 0x80) {
+            switch (ch) {
+            case '"':  buffer_.append("\\\""); break;
+            case '\\': buffer_.append("\\\\"); break;
+            case '\b': buffer_.append("\\b"); break;
+            case '\f': buffer_.append("\\f"); break;
+            case '\n': buffer_.append("\\n"); break;
+            case '\r': buffer_.append("\\r"); break;
+            case '\t': buffer_.append("\\t"); break;
+            default:
+                if (ch < 0x20) {
+                    buffer_.append("\\u00");
+                    buffer_.append(HEX[ch >> 4]);
+                    buffer_.append(HEX[ch & 0xf]);
+                }
+                else
+                    buffer_.append(char(ch));
+            }
+        }
+        else if (ch < 0x800) {
+            buffer_.append(char(0xc0 | (ch >> 6)));
+            buffer_.append(char(0x80 | (ch & 0x3f)));
+        }
+        else if (QChar::isHighSurrogate(ch) && x + 1 < size && data[x + 1].isLowSurrogate()) {
+            uint code = QChar::surrogateToUcs4(ch, data[++x].unicode());
+
+            buffer_.append(char(0xf0 | (code >> 18)));
+            buffer_.append(char(0x80 | ((code >> 12) & 0x3f)));
+            buffer_.append(char(0x80 | ((code >> 6) & 0x3f)));
+            buffer_.append(char(0x80 | (code & 0x3f)));
+        }
+        else if (QChar::isSurrogate(ch))
+            buffer_.append("\xef\xbf\xbd");
+        else {
+            buffer_.append(char(0xe0 | (ch >> 12)));
+            buffer_.append(char(0x80 | ((ch >> 6) & 0x3f)));
+            buffer_.append(char(0x80 | (ch & 0x3f)));
+        }
+    }
+    buffer_.append('"');
+}
@@ -0,0 +1,46 @@
+#ifndef JSONWRITER_H
+#define JSONWRITER_H
+
+#include <QByteArray>
+#include <QVariant>
+#include <QVarLengthArray>
+
+// Writes compact UTF-8 JSON straight into a byte buffer, without building
+// a QJsonDocument. The buffer is cleared but keeps its capacity, so a
+// buffer reused between responses stops reallocating after the first big
+// one. A lone UTF-16 surrogate is written as U+FFFD, the output is always
+// valid UTF-8.
+class JsonWriter
+{
+public:
+    explicit JsonWriter(QByteArray &buffer);
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+
+    void key(const QString &name);
+    void key(const char *name);
+
+    void value(const QVariant &value);
+    void value(const QString &value);
+    void value(qint64 value);
+    void value(double value);
+    void value(bool value);
+    void nullValue();
+
+    void writeMap(const QVariantMap &map);
+    void writeRows(const QVariantList &rows);
+
+private:
+    QByteArray &buffer_;
+    QVarLengthArray<bool, 16> first_;
+    bool afterKey_;
+
+    void separator();
+    void writeString(const QString &text);
+    void writeString(const QChar *data, int size);
+};
+
+#endif // JSONWRITER_H
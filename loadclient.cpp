@@ -0,0 +1,236 @@
+#include <QRandomGenerator>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QCborValue>
+#include <QCborMap>
+#include <QUrlQuery>
+#include <algorithm>
+
+#include "loadclient.h"
+#include "api.h"
+
+// reply of a command rejected by the full queue
+#define SERVER_BUSY     "server_busy"
+
+//=============================================================================
+// class LoadMix
+//=============================================================================
+bool LoadMix::parse(const QString &text, QString &errText)
+{
+    // short names of the mix and the commands they send
+    QHash<QString, QString> names;
+
+    names["login"] = COMMAND::CMD_LOGIN;
+    names["peoples"] = COMMAND::CMD_GET_PEOPLES;
+    names["groups"] = COMMAND::CMD_ITEMS_GROUPS;
+    names["items"] = COMMAND::CMD_ITEMS;
+    names["tables"] = COMMAND::CMD_GET_TABLES;
+    names["table_busy"] = COMMAND::CMD_GET_TABLE_BUSY;
+    names["time"] = COMMAND::CMD_GET_TIME;
+    names["order"] = COMMAND::CMD_ADD_ORDER;
+
+    commands_.clear();
+    total_ = 0;
+
+    foreach (const QString &part, text.split(',', Qt::SkipEmptyParts)) {
+        QStringList pair = part.trimmed().split('=');
+        int weight = pair.size() > 1 ? pair[1].toInt() : 1;
+        QString cmd = names.value(pair[0]);
+
+        if (cmd.isEmpty() == true || weight <= 0) {
+            errText = QString("Bad mix entry: %1").arg(part);
+            return false;
+        }
+
+        total_ += weight;
+        commands_ << qMakePair(total_, cmd);
+    }
+
+    if (commands_.isEmpty() == true) {
+        errText = "Empty command mix";
+        return false;
+    }
+
+    return true;
+}
+
+QString LoadMix::next() const
+{
+    int pick = QRandomGenerator::global()->bounded(total_);
+
+    foreach (const auto &command, commands_) {
+        if (pick < command.first)
+            return command.second;
+    }
+
+    return commands_.last().second;
+}
+
+//=============================================================================
+// class LoadStats
+//=============================================================================
+LoadStats::LoadStats() :
+    replies_(0),
+    busy_(0),
+    connectFailures_(0)
+{
+}
+
+void LoadStats::add(const QString &cmd, qint64 us, bool busy)
+{
+    replies_++;
+    if (busy == true)
+        busy_++;
+    else
+        latencies_[cmd] << us;
+}
+
+static double percentile(const QVector<qint64> &sorted, double q)
+{
+    int index = qMin(int(q * sorted.size()), sorted.size() - 1);
+
+    return sorted[index] / 1000.0;
+}
+
+QString LoadStats::report(double seconds)
+{
+    QString text;
+
+    text += QString("%1 replies in %2 s, %3 replies/s, %4 rejected as busy, %5 failed connects\n")
+            .arg(replies_).arg(seconds, 0, 'f', 1).arg(replies_ / seconds, 0, 'f', 1)
+            .arg(busy_).arg(connectFailures_);
+    text += QString("%1 %2 %3 %4 %5 %6 %7\n").arg("command", -24).arg("count", 9).arg("per s", 9)
+            .arg("p50 ms", 9).arg("p95 ms", 9).arg("p99 ms", 9).arg("max ms", 9);
+
+    for (QHash<QString, QVector<qint64> >::iterator it = latencies_.begin(); it != latencies_.end(); ++it) {
+        QVector<qint64> &sorted = it.value();
+
+        std::sort(sorted.begin(), sorted.end());
+        text += QString("%1 %2 %3 %4 %5 %6 %7\n").arg(it.key(), -24).arg(sorted.size(), 9)
+                .arg(sorted.size() / seconds, 9, 'f', 1)
+                .arg(percentile(sorted, 0.50), 9, 'f', 2).arg(percentile(sorted, 0.95), 9, 'f', 2)
+                .arg(percentile(sorted, 0.99), 9, 'f', 2).arg(sorted.last() / 1000.0, 9, 'f', 2);
+    }
+
+    return text;
+}
+
+//=============================================================================
+// class LoadClient
+//=============================================================================
+LoadClient::LoadClient(const QUrl &url, bool cbor, const QString &password, int thinkMs,
+                       const LoadMix *mix, LoadStats *stats, QObject *parent) : QObject(parent),
+    url_(url),
+    cbor_(cbor),
+    password_(password),
+    mix_(mix),
+    stats_(stats),
+    reqId_(0),
+    connected_(false),
+    stopped_(false)
+{
+    if (cbor_ == true) {
+        QUrlQuery query(url_);
+
+        query.addQueryItem("protocol", "cbor");
+        url_.setQuery(query);
+    }
+
+    thinkTimer_.setSingleShot(true);
+    thinkTimer_.setInterval(thinkMs);
+
+    connect(&socket_, &QWebSocket::connected, this, &LoadClient::onConnected);
+    connect(&socket_, &QWebSocket::disconnected, this, &LoadClient::onDisconnected);
+    connect(&socket_, QOverload<QAbstractSocket::SocketError>::of(&QWebSocket::error), this, [this]() {
+        if (connected_ == false && stopped_ == false)
+            stats_->connectFailed();
+    });
+    connect(&socket_, &QWebSocket::textMessageReceived, this, [this](const QString &message) {
+        onReply(QJsonDocument::fromJson(message.toUtf8()).object().toVariantMap());
+    });
+    connect(&socket_, &QWebSocket::binaryMessageReceived, this, [this](const QByteArray &message) {
+        onReply(QCborValue::fromCbor(message).toMap().toVariantMap());
+    });
+    connect(&thinkTimer_, &QTimer::timeout, this, &LoadClient::sendNext);
+}
+
+void LoadClient::start()
+{
+    socket_.open(url_);
+}
+
+void LoadClient::stop()
+{
+    stopped_ = true;
+    thinkTimer_.stop();
+    socket_.close();
+}
+
+void LoadClient::onConnected()
+{
+    connected_ = true;
+    sendNext();
+}
+
+void LoadClient::onDisconnected()
+{
+    connected_ = false;
+    cmd_.clear();
+}
+
+void LoadClient::onReply(const QVariantMap &reply)
+{
+    bool busy = reply.value("res").toString() == SERVER_BUSY;
+
+    if (cmd_.isEmpty() == true)
+        return;
+
+    if (reply.contains("req_id") == true) {
+        if (reply.value("req_id").toLongLong() != reqId_)
+            return;
+    }
+    // a command refused before it was read comes back without its "req_id"
+    else if (busy == false)
+        return;
+
+    stats_->add(cmd_, sent_.nsecsElapsed() / 1000, busy);
+    cmd_.clear();
+
+    if (stopped_ == true)
+        return;
+
+    if (thinkTimer_.interval() > 0)
+        thinkTimer_.start();
+    else
+        sendNext();
+}
+
+void LoadClient::sendNext()
+{
+    QJsonObject json;
+
+    if (stopped_ == true || connected_ == false)
+        return;
+
+    cmd_ = mix_->next();
+    json["cmd"] = cmd_;
+    json["req_id"] = ++reqId_;
+    if (cmd_ == COMMAND::CMD_LOGIN)
+        json["people_password"] = password_;
+    else if (cmd_ == COMMAND::CMD_ADD_ORDER) {
+        QJsonObject line;
+
+        line["item_id"] = 1;
+        line["quantity"] = 1;
+        json["table_id"] = 1;
+        json["people_id"] = 1;
+        json["lines"] = QJsonArray() << line;
+    }
+
+    sent_.start();
+    if (cbor_ == true)
+        socket_.sendBinaryMessage(QCborMap::fromJsonObject(json).toCborValue().toCbor());
+    else
+        socket_.sendTextMessage(QString::fromUtf8(QJsonDocument(json).toJson(QJsonDocument::Compact)));
+}
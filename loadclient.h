@@ -0,0 +1,81 @@
+#ifndef LOADCLIENT_H
+#define LOADCLIENT_H
+
+#include <QObject>
+#include <QWebSocket>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QHash>
+#include <QVector>
+#include <QPair>
+#include <QVariant>
+
+// Weighted command mix of the load test, e.g. "table_busy=10,items=1".
+class LoadMix
+{
+public:
+    bool parse(const QString &text, QString &errText);
+    QString next() const;
+
+private:
+    QVector<QPair<int, QString> > commands_;
+    int total_;
+};
+
+// Reply latencies of a load test run, by command, in microseconds.
+class LoadStats
+{
+public:
+    LoadStats();
+
+    void add(const QString &cmd, qint64 us, bool busy);
+    void connectFailed() { connectFailures_++; }
+
+    quint64 replies() const { return replies_; }
+    quint64 busy() const { return busy_; }
+    QString report(double seconds);
+
+private:
+    QHash<QString, QVector<qint64> > latencies_;
+    quint64 replies_;
+    quint64 busy_;
+    int connectFailures_;
+};
+
+// One simulated tablet: sends a command of the mix, waits for the reply
+// carrying its "req_id", records its latency and sends the next one after
+// the think time. Pushes and late replies are not counted.
+class LoadClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    LoadClient(const QUrl &url, bool cbor, const QString &password, int thinkMs,
+               const LoadMix *mix, LoadStats *stats, QObject *parent = 0);
+
+    void start();
+    void stop();
+    bool isConnected() const { return connected_; }
+
+private Q_SLOTS:
+    void onConnected();
+    void onDisconnected();
+    void onReply(const QVariantMap &reply);
+    void sendNext();
+
+private:
+    QWebSocket socket_;
+    QUrl url_;
+    bool cbor_;
+    QString password_;
+    const LoadMix *mix_;
+    LoadStats *stats_;
+    QTimer thinkTimer_;
+    QElapsedTimer sent_;
+    QString cmd_;
+    qint64 reqId_;
+    bool connected_;
+    bool stopped_;
+};
+
+#endif // LOADCLIENT_H
@@ -3,17 +3,15 @@
 
 #include <QMainWindow>
 #include <QScopedPointer>
-#include <QJsonObject>
+#include <QTimer>
 
 namespace Ui {
     class MainWindow;
 }
 
-class QWebSocketServer;
-class QWebSocket;
-class DataManager;
-class Configuration;
+class RPServer;
 
+// Monitor window over an in-process server, shows its log.
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
@@ -23,33 +21,13 @@ public:
     ~MainWindow();
 
 private Q_SLOTS:
-    void onNewConnection();
-    void processTextMessage(QString message);
-    void socketDisconnected();
+    void refreshLog();
 
 private:
-    typedef QString (MainWindow::*cmdFunction)(const QJsonObject &);
-    typedef std::map<QString, cmdFunction> MapFunction;
-
     Ui::MainWindow *ui_;
-    QScopedPointer<QWebSocketServer> webSocketServer_;
-    QScopedPointer<DataManager> dataManager_;
-    QScopedPointer<Configuration> configuration_;
-
-    QList<QWebSocket *> connections_;
-    MapFunction funcMap_;
-
-    QString cmdLogin(const QJsonObject &json);
-    QString cmdGetPeoples(const QJsonObject &json);
-    QString cmdGetItemsGroups(const QJsonObject &json);
-    QString cmdGetItems(const QJsonObject &json);
-
-    QString cmdGetTables(const QJsonObject &json);
-    QString cmdGetTableBusy(const QJsonObject &json);
-
-    QString cmdGetTime(const QJsonObject &json);
-
-    void addLogInfo(const QString &text);
+    QScopedPointer<RPServer> server_;
+    QTimer logTimer_;
+    quint64 logShown_;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,68 @@
+#include <QTcpSocket>
+
+#include "metricsserver.h"
+#include "serverstats.h"
+
+// a request head bigger than this is not a scraper's
+static const int MAX_REQUEST_SIZE = 8192;
+
+MetricsServer::MetricsServer(const ServerStats *stats, QObject *parent) : QTcpServer(parent),
+    stats_(stats)
+{
+    connect(this, &QTcpServer::newConnection, this, &MetricsServer::onNewConnection);
+}
+
+bool MetricsServer::start(quint16 port)
+{
+    return listen(QHostAddress::LocalHost, port);
+}
+
+void MetricsServer::onNewConnection()
+{
+    while (hasPendingConnections() == true) {
+        QTcpSocket *socket = nextPendingConnection();
+
+        connect(socket, &QTcpSocket::readyRead, this, &MetricsServer::onReadyRead);
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+    }
+}
+
+void MetricsServer::onReadyRead()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    QList<QByteArray> requestLine;
+
+    if (!socket)
+        return;
+
+    // answer once the whole request head is in
+    if (socket->peek(MAX_REQUEST_SIZE).contains("\r\n\r\n") == false) {
+        if (socket->bytesAvailable() >= MAX_REQUEST_SIZE)
+            reply(socket, "400 Bad Request", QByteArray());
+        return;
+    }
+
+    requestLine = socket->readLine().trimmed().split(' ');
+    socket->readAll();
+
+    if (requestLine.size() < 2 || requestLine[0] != "GET")
+        reply(socket, "405 Method Not Allowed", QByteArray());
+    else if (requestLine[1] != "/metrics")
+        reply(socket, "404 Not Found", QByteArray());
+    else
+        reply(socket, "200 OK", stats_->toPrometheus());
+}
+
+void MetricsServer::reply(QTcpSocket *socket, const QByteArray &status, const QByteArray &body)
+{
+    QByteArray head;
+
+    head += "HTTP/1.1 " + status + "\r\n";
+    head += "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n";
+    head += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    head += "Connection: close\r\n\r\n";
+
+    disconnect(socket, &QTcpSocket::readyRead, this, &MetricsServer::onReadyRead);
+    socket->write(head + body);
+    socket->disconnectFromHost();
+}
@@ -0,0 +1,31 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QTcpServer>
+
+class QTcpSocket;
+class ServerStats;
+
+// Minimal HTTP endpoint answering GET /metrics with the server stats in
+// the Prometheus text format. Meant for a local scraper, so it listens on
+// localhost only and closes the connection after each answer.
+class MetricsServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    MetricsServer(const ServerStats *stats, QObject *parent = 0);
+
+    bool start(quint16 port);
+
+private Q_SLOTS:
+    void onNewConnection();
+    void onReadyRead();
+
+private:
+    const ServerStats *stats_;
+
+    void reply(QTcpSocket *socket, const QByteArray &status, const QByteArray &body);
+};
+
+#endif // METRICSSERVER_H
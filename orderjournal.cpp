@@ -0,0 +1,313 @@
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QCborValue>
+#include <QCborMap>
+#include <QtEndian>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "orderjournal.h"
+
+// next to the journal, the sequence of the last order in the database
+#define APPLIED_SUFFIX      ".applied"
+
+// next to the journal, one JSON line per order the database refused
+#define REJECTED_SUFFIX     ".rejected"
+
+// size and checksum in front of every record
+static const int RECORD_HEAD = 6;
+
+// first byte of every record, the CBOR head of the {seq, order} map
+static const uchar RECORD_START = 0xa2;
+
+// applied records are cut off the front of the journal past this size
+static const qint64 COMPACT_SIZE = 4 * 1024 * 1024;
+
+// Size of the intact record at pos, -1 when there is none there.
+static int recordSize(const QByteArray &data, int pos)
+{
+    const uchar *head = reinterpret_cast<const uchar *>(data.constData() + pos);
+    quint32 size;
+
+    if (data.size() - pos < RECORD_HEAD)
+        return -1;
+
+    size = qFromBigEndian<quint32>(head);
+    if (size == 0 || size > quint32(data.size() - pos - RECORD_HEAD) || head[RECORD_HEAD] != RECORD_START
+            || qChecksum(data.constData() + pos + RECORD_HEAD, size) != qFromBigEndian<quint16>(head + 4))
+        return -1;
+
+    return int(size);
+}
+
+static bool syncFile(QFile &file)
+{
+    if (file.flush() == false)
+        return false;
+
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+OrderJournal::OrderJournal(const QString &fileName) :
+    fileName_(fileName),
+    file_(fileName),
+    lastSeq_(0),
+    stopping_(false)
+{
+}
+
+// Reads back the orders not yet applied and cuts off a torn last batch.
+// A damaged record with intact ones behind it was not torn by a crash,
+// the open fails and the file is left as it is.
+bool OrderJournal::open(QString &errText)
+{
+    QMutexLocker locker(&mutex_);
+    QByteArray data;
+    quint64 applied;
+    int pos = 0;
+
+    if (readApplied(applied) == false) {
+        errText = "unreadable " APPLIED_SUFFIX " file";
+        return false;
+    }
+    lastSeq_ = applied;
+
+    if (file_.open(QIODevice::ReadWrite) == false) {
+        errText = file_.errorString();
+        return false;
+    }
+
+    data = file_.readAll();
+    while (pos < data.size()) {
+        int size = recordSize(data, pos);
+        QCborMap record;
+        Record entry;
+
+        if (size < 0)
+            break;
+
+        record = QCborValue::fromCbor(data.mid(pos + RECORD_HEAD, size)).toMap();
+        entry.seq = quint64(record.value(QLatin1String("seq")).toInteger());
+        entry.pos = pos;
+        entry.order = record.value(QLatin1String("order")).toMap().toVariantMap();
+        if (entry.seq > applied)
+            pending_ << entry;
+        lastSeq_ = qMax(lastSeq_, entry.seq);
+
+        pos += RECORD_HEAD + size;
+    }
+
+    // only the tail written by the last append can be torn
+    for (int x = pos + 1; x < data.size(); ++x) {
+        if (recordSize(data, x) >= 0) {
+            errText = QString("damaged record at offset %1 with intact records behind it").arg(pos);
+            pending_.clear();
+            file_.close();
+            return false;
+        }
+    }
+
+    if ((pos < data.size() && file_.resize(pos) == false) || file_.seek(pos) == false) {
+        errText = file_.errorString();
+        file_.close();
+        return false;
+    }
+
+    return true;
+}
+
+// Writes the orders as one batch and syncs it to disk, false when the
+// disk refused it and none of the orders may be acknowledged.
+bool OrderJournal::append(const QVariantList &orders, QString &errText)
+{
+    QMutexLocker locker(&mutex_);
+    QByteArray data;
+    QList<Record> records;
+    quint64 seq = lastSeq_;
+    qint64 start = file_.pos();
+
+    foreach (const QVariant &order, orders) {
+        QCborMap record;
+        QByteArray payload;
+        char head[RECORD_HEAD];
+        Record entry;
+
+        entry.seq = ++seq;
+        entry.pos = start + data.size();
+        entry.order = order.toMap();
+        record.insert(QLatin1String("seq"), qint64(entry.seq));
+        record.insert(QLatin1String("order"), QCborMap::fromVariantMap(entry.order));
+        payload = record.toCborValue().toCbor();
+
+        qToBigEndian(quint32(payload.size()), head);
+        qToBigEndian(qChecksum(payload.constData(), payload.size()), head + 4);
+        data.append(head, RECORD_HEAD).append(payload);
+        records << entry;
+    }
+
+    if (file_.write(data) != data.size() || syncFile(file_) == false) {
+        errText = file_.errorString();
+        // a partly written batch is cut off again
+        file_.resize(start);
+        file_.seek(start);
+        return false;
+    }
+
+    lastSeq_ = seq;
+    pending_ << records;
+    ready_.wakeAll();
+
+    return true;
+}
+
+// The oldest orders not yet applied, waiting for some to arrive. False
+// once the journal is stopped.
+bool OrderJournal::pending(int max, QList<Record> &records)
+{
+    QMutexLocker locker(&mutex_);
+
+    while (pending_.isEmpty() == true && stopping_ == false)
+        ready_.wait(&mutex_);
+
+    if (stopping_ == true)
+        return false;
+
+    records = pending_.mid(0, max);
+    return true;
+}
+
+// Records the orders up to seq as written to the database. Once the
+// applied records at its front are large enough the journal starts over
+// with only the rest.
+bool OrderJournal::markApplied(quint64 seq, QString &errText)
+{
+    QMutexLocker locker(&mutex_);
+    qint64 offset;
+
+    if (writeApplied(seq, errText) == false)
+        return false;
+
+    while (pending_.isEmpty() == false && pending_.first().seq <= seq)
+        pending_.removeFirst();
+
+    offset = pending_.isEmpty() == true ? file_.size() : pending_.first().pos;
+    if (offset > COMPACT_SIZE)
+        return compact(offset, errText);
+
+    return true;
+}
+
+// Keeps a refused order with the reason in the reject file. The caller
+// marks it applied afterwards, so it no longer holds up the orders
+// behind it.
+bool OrderJournal::reject(const Record &record, const QString &reason, QString &errText)
+{
+    QMutexLocker locker(&mutex_);
+    QFile file(fileName_ + REJECTED_SUFFIX);
+    QVariantMap line;
+    QByteArray data;
+
+    line["seq"] = record.seq;
+    line["error"] = reason;
+    line["order"] = record.order;
+    data = QJsonDocument::fromVariant(line).toJson(QJsonDocument::Compact) + '\n';
+
+    if (file.open(QIODevice::WriteOnly | QIODevice::Append) == false || file.write(data) != data.size()
+            || syncFile(file) == false) {
+        errText = file.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+int OrderJournal::backlog() const
+{
+    QMutexLocker locker(&mutex_);
+
+    return pending_.size();
+}
+
+void OrderJournal::stop()
+{
+    QMutexLocker locker(&mutex_);
+
+    stopping_ = true;
+    ready_.wakeAll();
+}
+
+bool OrderJournal::readApplied(quint64 &seq) const
+{
+    QFile file(fileName_ + APPLIED_SUFFIX);
+    bool ok;
+
+    seq = 0;
+    if (file.exists() == false)
+        return true;
+    if (file.open(QIODevice::ReadOnly) == false)
+        return false;
+
+    seq = file.readAll().trimmed().toULongLong(&ok);
+    return ok;
+}
+
+// Replaces the journal with its part from offset on, the records not
+// yet applied. Under steady traffic that is a short tail.
+bool OrderJournal::compact(qint64 offset, QString &errText)
+{
+    QSaveFile file(fileName_);
+    QByteArray tail;
+    qint64 end = file_.size();
+    bool committed;
+
+    if (file_.seek(offset) == false) {
+        errText = file_.errorString();
+        file_.seek(end);
+        return false;
+    }
+
+    tail = file_.readAll();
+    if (file.open(QIODevice::WriteOnly) == false || file.write(tail) != tail.size()) {
+        errText = file.errorString();
+        file_.seek(end);
+        return false;
+    }
+
+    // the rename needs the journal closed on some systems
+    file_.close();
+    committed = file.commit();
+    if (committed == false)
+        errText = file.errorString();
+    else {
+        for (int x = 0; x < pending_.size(); ++x)
+            pending_[x].pos -= offset;
+    }
+
+    if (file_.open(QIODevice::ReadWrite) == false || file_.seek(file_.size()) == false) {
+        errText = file_.errorString();
+        return false;
+    }
+
+    return committed;
+}
+
+bool OrderJournal::writeApplied(quint64 seq, QString &errText) const
+{
+    QSaveFile file(fileName_ + APPLIED_SUFFIX);
+
+    if (file.open(QIODevice::WriteOnly) == false || file.write(QByteArray::number(seq)) < 0
+            || file.commit() == false) {
+        errText = file.errorString();
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,55 @@
+#ifndef ORDERJOURNAL_H
+#define ORDERJOURNAL_H
+
+#include <QFile>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVariant>
+
+// Append-only file of the orders accepted but maybe not yet in the
+// database. Orders are acknowledged once their batch is on disk, one
+// fsync per batch, and a replayer writes them to the database in order
+// afterwards. The sequence of the last order in the database is kept
+// next to the journal, so after a restart only the rest is replayed.
+// A record cut short by a power loss was never acknowledged and is
+// dropped when the journal is opened, a damaged record anywhere before
+// the end fails the open. Orders the database refuses for good are
+// moved to a reject file next to the journal.
+class OrderJournal
+{
+public:
+    struct Record {
+        quint64 seq;
+        qint64 pos;
+        QVariantMap order;
+    };
+
+    explicit OrderJournal(const QString &fileName);
+
+    QString fileName() const { return fileName_; }
+
+    bool open(QString &errText);
+    bool append(const QVariantList &orders, QString &errText);
+
+    bool pending(int max, QList<Record> &records);
+    bool markApplied(quint64 seq, QString &errText);
+    bool reject(const Record &record, const QString &reason, QString &errText);
+    int backlog() const;
+    void stop();
+
+private:
+    QString fileName_;
+    QFile file_;
+
+    mutable QMutex mutex_;
+    QWaitCondition ready_;
+    QList<Record> pending_;
+    quint64 lastSeq_;
+    bool stopping_;
+
+    bool readApplied(quint64 &seq) const;
+    bool writeApplied(quint64 seq, QString &errText) const;
+    bool compact(qint64 offset, QString &errText);
+};
+
+#endif // ORDERJOURNAL_H
@@ -0,0 +1,131 @@
+#include <QScopedPointer>
+
+#include "orderreplayer.h"
+#include "databackend.h"
+#include "serverlog.h"
+
+// wait before the same batch is tried again, ms
+static const int REPLAY_RETRY_INTERVAL = 2000;
+
+OrderReplayer::OrderReplayer(OrderJournal *journal, const DataBackendFactory *backend, const QString &dbName,
+                             int maxBatch, ServerLog *log) :
+    journal_(journal),
+    backend_(backend),
+    dbName_(dbName),
+    maxBatch_(qMax(maxBatch, 1)),
+    log_(log),
+    stopping_(false)
+{
+}
+
+OrderReplayer::~OrderReplayer()
+{
+    stop();
+    wait();
+}
+
+// Whatever is not replayed yet stays in the journal for the next start.
+void OrderReplayer::stop()
+{
+    QMutexLocker locker(&mutex_);
+
+    stopping_ = true;
+    wake_.wakeAll();
+    journal_->stop();
+}
+
+void OrderReplayer::run()
+{
+    QScopedPointer<DataBackend> backend(backend_->create());
+    QList<OrderJournal::Record> records;
+    QString errText;
+    bool failing = false;
+
+    if (backend->connect(dbName_, "SYSDBA", "masterkey", errText) == false)
+        log_->write(ServerLog::Error, trUtf8("Error connecting order replay to database... ") + errText);
+
+    if (journal_->backlog() > 0)
+        log_->write(ServerLog::Info, QString(trUtf8("Replaying %1 journaled orders...")).arg(journal_->backlog()));
+
+    while (journal_->pending(maxBatch_, records) == true) {
+        quint64 applied = 0;
+        bool written = replay(backend.data(), records, applied, errText);
+
+        // what was dealt with before a failure is not replayed again
+        if (applied > 0 && journal_->markApplied(applied, errText) == false) {
+            log_->write(ServerLog::Error, trUtf8("Error updating order journal... ") + errText);
+            written = false;
+        }
+
+        if (written == true) {
+            if (failing == true)
+                log_->write(ServerLog::Info, trUtf8("Order replay resumed"));
+            failing = false;
+            continue;
+        }
+
+        if (failing == false)
+            log_->write(ServerLog::Error, trUtf8("Error replaying orders, retrying... ") + errText);
+        failing = true;
+        if (pause(REPLAY_RETRY_INTERVAL) == false)
+            break;
+    }
+}
+
+// Writes the records in one transaction. When the database refuses them
+// but answers a ping, they are written again one at a time and an order
+// refused on its own is rejected. False while the database is away,
+// applied is the last record written or rejected before that.
+bool OrderReplayer::replay(DataBackend *backend, const QList<OrderJournal::Record> &records, quint64 &applied,
+                           QString &errText)
+{
+    QVariantList orders;
+    QVariantList results;
+    QString writeErr;
+
+    foreach (const OrderJournal::Record &record, records)
+        orders << record.order;
+
+    errText.clear();
+    backend->check(errText);
+    if (backend->writeOrders(orders, results, writeErr) == true) {
+        applied = records.last().seq;
+        return true;
+    }
+
+    if (backend->ping(errText) == false) {
+        errText = writeErr;
+        return false;
+    }
+
+    if (records.size() == 1) {
+        log_->write(ServerLog::Error, QString(trUtf8("Order %1 refused by the database, moved to the reject file... "))
+                                      .arg(records[0].seq) + writeErr);
+        if (journal_->reject(records[0], writeErr, errText) == false) {
+            errText = trUtf8("Error writing reject file... ") + errText;
+            return false;
+        }
+        applied = records[0].seq;
+        return true;
+    }
+
+    log_->write(ServerLog::Error, QString(trUtf8("Error replaying %1 orders, replaying them one by one... "))
+                                  .arg(records.size()) + writeErr);
+    foreach (const OrderJournal::Record &record, records) {
+        if (replay(backend, QList<OrderJournal::Record>() << record, applied, errText) == false)
+            return false;
+    }
+
+    return true;
+}
+
+// False when stopped during the pause.
+bool OrderReplayer::pause(int ms)
+{
+    QMutexLocker locker(&mutex_);
+
+    if (stopping_ == false)
+        wake_.wait(&mutex_, ms);
+
+    return stopping_ == false;
+}
@@ -0,0 +1,52 @@
+#ifndef ORDERREPLAYER_H
+#define ORDERREPLAYER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include "orderjournal.h"
+
+class ServerLog;
+class DataBackend;
+class DataBackendFactory;
+
+// Drains the order journal into the database in journal order, a batch
+// per transaction on its own connection. While the database is away it
+// keeps retrying the same batch, the journal holds everything behind it.
+// A batch the database refuses while it is reachable is written again
+// order by order, and an order still refused goes to the reject file so
+// it can't hold up the ones behind it. Orders carry their keys, so a
+// batch written again after a crash or a lost commit reply is not
+// written twice.
+class OrderReplayer : public QThread
+{
+    Q_OBJECT
+
+public:
+    OrderReplayer(OrderJournal *journal, const DataBackendFactory *backend, const QString &dbName,
+                  int maxBatch, ServerLog *log);
+    ~OrderReplayer();
+
+    void stop();
+
+protected:
+    void run();
+
+private:
+    OrderJournal *journal_;
+    const DataBackendFactory *backend_;
+    QString dbName_;
+    int maxBatch_;
+    ServerLog *log_;
+
+    QMutex mutex_;
+    QWaitCondition wake_;
+    bool stopping_;
+
+    bool replay(DataBackend *backend, const QList<OrderJournal::Record> &records, quint64 &applied,
+                QString &errText);
+    bool pause(int ms);
+};
+
+#endif // ORDERREPLAYER_H
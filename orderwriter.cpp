@@ -0,0 +1,157 @@
+#include <QDeadlineTimer>
+#include <QScopedPointer>
+
+#include "orderwriter.h"
+#include "rpserver.h"
+#include "databackend.h"
+#include "orderjournal.h"
+#include "api.h"
+
+OrderWriter::OrderWriter(RPServer *server, const DataBackendFactory *backend, const QString &dbName,
+                         OrderJournal *journal, int window, int maxBatch, int maxQueue) :
+    server_(server),
+    backend_(backend),
+    dbName_(dbName),
+    journal_(journal),
+    window_(window),
+    maxBatch_(qMax(maxBatch, 1)),
+    maxQueue_(maxQueue),
+    stopping_(false)
+{
+}
+
+OrderWriter::~OrderWriter()
+{
+    stop();
+    wait();
+}
+
+// Queues an order, false when the queue is full or the writer stopped.
+// The reply is posted by the writer.
+bool OrderWriter::submit(const Request &request, const QVariantMap &order)
+{
+    QMutexLocker locker(&mutex_);
+
+    if (stopping_ == true || queue_.size() >= maxQueue_)
+        return false;
+
+    queue_.append(Pending(request, order));
+    wake_.wakeOne();
+
+    return true;
+}
+
+// Orders already queued are still written before the thread ends.
+void OrderWriter::stop()
+{
+    QMutexLocker locker(&mutex_);
+
+    stopping_ = true;
+    wake_.wakeOne();
+}
+
+void OrderWriter::run()
+{
+    QScopedPointer<DataBackend> backend;
+    QString errText;
+
+    // with a journal only the replayer talks to the database
+    if (!journal_) {
+        backend.reset(backend_->create());
+        if (backend->connect(dbName_, "SYSDBA", "masterkey", errText) == false)
+            server_->log()->write(ServerLog::Error, trUtf8("Error connecting order writer to database... ") + errText);
+    }
+
+    QMutexLocker locker(&mutex_);
+
+    for (;;) {
+        QList<Pending> batch;
+
+        while (queue_.isEmpty() == true && stopping_ == false)
+            wake_.wait(&mutex_);
+        if (queue_.isEmpty() == true)
+            break;
+
+        // the first order waits at most the window for others to join it
+        QDeadlineTimer deadline(window_);
+
+        while (queue_.size() < maxBatch_ && stopping_ == false && wake_.wait(&mutex_, deadline) == true)
+            ;
+
+        while (queue_.isEmpty() == false && batch.size() < maxBatch_)
+            batch.append(queue_.takeFirst());
+
+        locker.unlock();
+        if (journal_)
+            journal(batch);
+        else
+            write(backend.data(), batch);
+        locker.relock();
+    }
+}
+
+void OrderWriter::write(DataBackend *backend, const QList<Pending> &batch)
+{
+    QVariantList orders;
+    QVariantList results;
+    QString errText;
+
+    foreach (const Pending &pending, batch)
+        orders << pending.order;
+
+    backend->check(errText);
+    if (backend->writeOrders(orders, results, errText) == true) {
+        for (int x = 0; x < batch.size(); ++x)
+            reply(batch[x], results.value(x).toMap(), QString());
+        return;
+    }
+
+    if (batch.size() == 1) {
+        server_->log()->write(ServerLog::Error, trUtf8("Error writing order... ") + errText);
+        reply(batch[0], QVariantMap(), errText);
+        return;
+    }
+
+    server_->log()->write(ServerLog::Error, QString(trUtf8("Error writing %1 orders, writing them one by one... "))
+                                            .arg(batch.size()) + errText);
+    foreach (const Pending &pending, batch)
+        write(backend, QList<Pending>() << pending);
+}
+
+// One sync for the whole batch, every order is acknowledged once it is
+// on disk.
+void OrderWriter::journal(const QList<Pending> &batch)
+{
+    QVariantList orders;
+    QVariantMap result;
+    QString errText;
+
+    foreach (const Pending &pending, batch)
+        orders << pending.order;
+
+    if (journal_->append(orders, errText) == false) {
+        if (errText.isEmpty() == true)
+            errText = "journal write failed";
+        server_->log()->write(ServerLog::Error, QString(trUtf8("Error journaling %1 orders... ")).arg(batch.size()) + errText);
+    }
+    else
+        result["journaled"] = true;
+
+    foreach (const Pending &pending, batch)
+        reply(pending, result, errText);
+}
+
+void OrderWriter::reply(const Pending &pending, const QVariantMap &result, const QString &errText)
+{
+    QVariantMap pMap = errText.isEmpty() == true ? result : RPServer::errorReply("write_failed");
+
+    if (errText.isEmpty() == true) {
+        pMap["err"] = ERROR::API_ERROR_NONE;
+        pMap["write_key"] = pending.order.value("write_key");
+        if (pending.order.contains("order_key") == true)
+            pMap["order_key"] = pending.order.value("order_key");
+    }
+    pMap["res"] = pending.request.cmd();
+
+    server_->postResponse(pending.request, pending.request.encode(pMap));
+}
@@ -0,0 +1,64 @@
+#ifndef ORDERWRITER_H
+#define ORDERWRITER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVariant>
+
+#include "request.h"
+
+class RPServer;
+class DataBackend;
+class DataBackendFactory;
+class OrderJournal;
+
+// Group commit for the order commands. Orders from every connection wait
+// at most the batch window for each other, then go to the database in
+// one transaction, and each gets its own reply once that transaction has
+// committed. A batch the database refuses is written again order by
+// order, so one bad order fails alone. With a journal the batch is only
+// synced to the journal and acknowledged, the replayer takes it to the
+// database later.
+class OrderWriter : public QThread
+{
+    Q_OBJECT
+
+public:
+    OrderWriter(RPServer *server, const DataBackendFactory *backend, const QString &dbName,
+                OrderJournal *journal, int window, int maxBatch, int maxQueue);
+    ~OrderWriter();
+
+    bool submit(const Request &request, const QVariantMap &order);
+    void stop();
+
+protected:
+    void run();
+
+private:
+    struct Pending {
+        Pending(const Request &r, const QVariantMap &o) : request(r), order(o) {}
+
+        Request request;
+        QVariantMap order;
+    };
+
+    RPServer *server_;
+    const DataBackendFactory *backend_;
+    QString dbName_;
+    OrderJournal *journal_;
+    int window_;
+    int maxBatch_;
+    int maxQueue_;
+
+    QMutex mutex_;
+    QWaitCondition wake_;
+    QList<Pending> queue_;
+    bool stopping_;
+
+    void write(DataBackend *backend, const QList<Pending> &batch);
+    void journal(const QList<Pending> &batch);
+    void reply(const Pending &pending, const QVariantMap &result, const QString &errText);
+};
+
+#endif // ORDERWRITER_H
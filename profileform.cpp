@@ -12,14 +12,9 @@
 #include "function.h"
 #include "treestyle.h"
 #include "logmanager.h"
-
-#define ID_PROFILE_INDEX        0
-#define NAME_PROFILE_INDEX      1
-#define FORMS_PROFILE_INDEX     2
-#define OPERS_PROFILE_INDEX     3
-#define PAYS_PROFILE_INDEX      4
-#define REPORTS_PROFILE_INDEX   5
-#define HOTKEYS_PROFILE_INDEX   6
+#include "profilerights.h"
+#include "profilemodel.h"
+#include "tablecolumns.h"
 
 #define KT_HOTKEY_INDEX         1
 
@@ -35,6 +30,9 @@ GProfileForm::GProfileForm( GStorage * st, bool select, QWidget *parent ) : QDia
     payItem_ = NULL;
     requestItem_ = NULL;
 
+    model_ = new GProfileModel( storage_, this );
+    ui_->profileTable->setModel( model_ );
+
     keyEdit_ = new GKeyEdit( this );
     qobject_cast< QHBoxLayout *>( ui_->keyGB->layout() )->insertWidget( 1, keyEdit_ );
 
@@ -87,11 +85,11 @@ GProfileForm::GProfileForm( GStorage * st, bool select, QWidget *parent ) : QDia
     connect( ui_->okBtn, SIGNAL( clicked() ), this, SLOT( onSaveProfile() ) );
     connect( ui_->cancelBtn, SIGNAL( clicked() ), this, SLOT( onCancelProfile() ) );
 
-    connect( ui_->profileTable, SIGNAL( currentCellChanged( int, int, int, int ) ),
-             this, SLOT( onCellClicked( int, int, int, int ) ) );
+    connect( ui_->profileTable->selectionModel(), SIGNAL( currentRowChanged( QModelIndex, QModelIndex ) ),
+             this, SLOT( onCurrentRowChanged( QModelIndex, QModelIndex ) ) );
     if ( select )
-        connect( ui_->profileTable, SIGNAL( cellDoubleClicked( int, int ) ),
-                 this, SLOT( onCellDoubleClicked( int, int ) ) );
+        connect( ui_->profileTable, SIGNAL( doubleClicked( QModelIndex ) ),
+                 this, SLOT( onCellDoubleClicked( QModelIndex ) ) );
 
     connect( ui_->profileEdit, SIGNAL( textEdited( QString ) ), this, SLOT( onEditProfile() ) );
     connect( ui_->tree, SIGNAL( itemChanged( QTreeWidgetItem*, int ) ), this, SLOT( onEditProfile() ) );
@@ -110,7 +108,8 @@ GProfileForm::GProfileForm( GStorage * st, bool select, QWidget *parent ) : QDia
     initRighTree();
     initKeyTree();
 
-    showProfile( gProfileUser );
+    model_->load();
+    showProfile( model_->findName( gProfileUser ) );
 }
 
 GProfileForm::~GProfileForm()
@@ -121,7 +120,7 @@ GProfileForm::~GProfileForm()
 void GProfileForm::initRighTree()
 {
     QTreeWidgetItem *item;
-    QStringList dataList;
+    GTableColumns payList;
     QList< int > reqList;
     QList< int > disList;
 
@@ -158,16 +157,13 @@ void GProfileForm::initRighTree()
         item->setCheckState( 0, Qt::Unchecked );
     }
 
+    // виды оплаты: ID и наименование
     payItem_ = new QTreeWidgetItem( ui_->tree, QStringList() << trUtf8( "Оплата" ) );
-    storage_->getTableData( PAY_TYPE_TABLE );
-    while ( true ) {
-        dataList = storage_->getTableRowData( PAY_TYPE_TABLE );
-        if ( dataList.count() == 0 )
-            break;
-
+    getTableColumns( storage_, PAY_TYPE_TABLE, payList, QList< int >() << 0 << 1, QList< int >() << 0 );
+    for ( int x = 0; x < payList.rowCount(); ++x ) {
         item = new QTreeWidgetItem( payItem_ );
-        item->setText( 0, dataList[ 1 ] );
-        item->setData( 0, Qt::UserRole, dataList[ 0 ] );
+        item->setText( 0, payList.text( x, 1 ) );
+        item->setData( 0, Qt::UserRole, payList.intValue( x, 0 ) );
         item->setCheckState( 0, Qt::Unchecked );
     }
 
@@ -204,7 +200,7 @@ void GProfileForm::initKeyTree()
             it->setData( 0, Qt::UserRole, group->hKeys_[ y ]->id_ );
 
             //отображать в профиле настройки гор.клавиши для спец. продажи только для пользователя 'developer'
-            if( group->hKeys_[ y ]->id_ == SPECIAL_MODE_HKEY && gIdUser != -1)
+            if( GHotKeyIndex::isHidden( group->hKeys_[ y ]->id_ ) )
                 it->setHidden( true );
         }
     }
@@ -215,12 +211,12 @@ void GProfileForm::initKeyTree()
 
 void GProfileForm::setControls()
 {
-    ui_->frame_2->setEnabled( ui_->profileTable->rowCount() );
+    ui_->frame_2->setEnabled( model_->rowCount() );
     ui_->profileTable->setEnabled( workMode_ == GProfileForm::wmView );
 
     ui_->addRowBtn->setEnabled( workMode_ == GProfileForm::wmView );
-    ui_->editRowBtn->setEnabled( workMode_ == GProfileForm::wmView && ui_->profileTable->rowCount() );
-    ui_->delRowBtn->setEnabled( workMode_ == GProfileForm::wmView && ui_->profileTable->rowCount() );
+    ui_->editRowBtn->setEnabled( workMode_ == GProfileForm::wmView && model_->rowCount() );
+    ui_->delRowBtn->setEnabled( workMode_ == GProfileForm::wmView && model_->rowCount() );
 
     ui_->okBtn->setEnabled( workMode_ != GProfileForm::wmView );
     ui_->cancelBtn->setEnabled( workMode_ != GProfileForm::wmView );
@@ -230,116 +226,88 @@ void GProfileForm::setControls()
     delMenu_->setEnabled( ui_->delRowBtn->isEnabled() );
 }
 
-void GProfileForm::showProfile( const QString &profile )
+void GProfileForm::showProfile( int row )
 {
-    ui_->profileTable->blockSignals( true );
-    storage_->showTableInTable( USERS_PROFILE_TABLE, ui_->profileTable );
-
-    if ( profile != "" )
-        for ( int x = 0; x < ui_->profileTable->rowCount(); ++x ) {
-            if ( ui_->profileTable->item( x, NAME_PROFILE_INDEX )->text() == profile ) {
-                ui_->profileTable->selectRow( x );
-                break;
-            }
-        }
+    if ( row < 0 && model_->rowCount() )
+        row = 0;
+
+    // смена текущей строки сама вызовет onCellClicked
+    if ( row == currentRow() )
+        onCellClicked( row, 0 );
+    else if ( row >= 0 )
+        ui_->profileTable->selectRow( row );
     else
-        if ( ui_->profileTable->rowCount() )
-            ui_->profileTable->selectRow( 0 );
-
-    onCellClicked( ui_->profileTable->currentRow(), 0 );
-    ui_->profileTable->blockSignals( false );
+        ui_->profileTable->setCurrentIndex( QModelIndex() );
 
     setControls();
 }
 
+int GProfileForm::currentRow() const
+{
+    return ui_->profileTable->currentIndex().row();
+}
+
+void GProfileForm::onCurrentRowChanged( const QModelIndex &current, const QModelIndex & )
+{
+    onCellClicked( current.row(), current.column() );
+}
+
 void GProfileForm::onCellClicked( int row, int, int, int )
 {
     clearEdits();
-    QVariantMap jMap;
-    Qt::CheckState chState;
+    QVariantMap pMap;
+    ProfileRights rights;
 
     if ( row < 0 )
         return;
 
-    ui_->profileEdit->setText( ui_->profileTable->item( row, NAME_PROFILE_INDEX )->text() );
-    ui_->profileEdit->setProperty( "profile", ui_->profileTable->item( row, NAME_PROFILE_INDEX )->text() );
+    ui_->profileEdit->setText( model_->text( row, NAME_PROFILE_INDEX ) );
+    ui_->profileEdit->setProperty( "profile", model_->text( row, NAME_PROFILE_INDEX ) );
 
     ui_->tree->setCurrentItem( NULL );
     ui_->tree->blockSignals( true );
 
-    // экраны
-    jMap = QJsonDocument::fromJson( ui_->profileTable->item( row, FORMS_PROFILE_INDEX )->text().toLocal8Bit() ).toVariant().toMap();
-    for ( int x = 0; x < formItem_->childCount(); ++x ) {
-        if ( jMap.contains( formItem_->child( x )->data( 0, Qt::UserRole ).toString() ) == true )
-            chState = jMap[ formItem_->child( x )->data( 0, Qt::UserRole ).toString() ].toBool() ? Qt::Checked : Qt::Unchecked;
-        else
-            chState = Qt::Checked;
-        formItem_->child( x )->setCheckState( 0, chState );
-    }
-
-    // операции
-    jMap = QJsonDocument::fromJson( ui_->profileTable->item( row, OPERS_PROFILE_INDEX )->text().toLocal8Bit() ).toVariant().toMap();
-    for ( int x = 0; x < operItem_->childCount(); ++x ) {
-        if ( jMap.contains( operItem_->child( x )->data( 0, Qt::UserRole ).toString() ) == true )
-            chState = jMap[ operItem_->child( x )->data( 0, Qt::UserRole ).toString() ].toBool() ? Qt::Checked : Qt::Unchecked;
-        else {
-            int op = operItem_->child( x )->data( 0, Qt::UserRole ).toInt();
-            chState = ( op != UO_SALE_GROUP &&
-                        op != UO_SORT_RECEIPT_COLUMN &&
-                        op != UO_FILTER_DISABLED_ART ) ? Qt::Checked : Qt::Unchecked;
-        }
-        operItem_->child( x )->setCheckState( 0, chState );
-    }
+    // права профиля разбираются один раз, умолчания уже учтены
+    pMap[ "forms" ] = model_->text( row, FORMS_PROFILE_INDEX );
+    pMap[ "opers" ] = model_->text( row, OPERS_PROFILE_INDEX );
+    pMap[ "pays" ] = model_->text( row, PAYS_PROFILE_INDEX );
+    pMap[ "reports" ] = model_->text( row, REPORTS_PROFILE_INDEX );
+    rights = ProfileRights::compile( pMap );
 
-    // запросы подтверждения
-    for ( int x = 0; x < requestItem_->childCount(); ++x ) {
-        if ( jMap.contains( requestItem_->child( x )->data( 0, Qt::UserRole ).toString() ) == true )
-            chState = jMap[ requestItem_->child( x )->data( 0, Qt::UserRole ).toString() ].toBool() ? Qt::Checked : Qt::Unchecked;
-        else
-            chState = Qt::Checked;
-        requestItem_->child( x )->setCheckState( 0, chState );
-    }
+    // экраны
+    setRightsChecks( formItem_, rights, ProfileRights::Forms );
 
-    // скидки
-    for ( int x = 0; x < discountItem_->childCount(); ++x ) {
-        if ( jMap.contains( discountItem_->child( x )->data( 0, Qt::UserRole ).toString() ) == true )
-            chState = jMap[ discountItem_->child( x )->data( 0, Qt::UserRole ).toString() ].toBool() ? Qt::Checked : Qt::Unchecked;
-        else
-            chState = Qt::Checked;
-        discountItem_->child( x )->setCheckState( 0, chState );
-    }
+    // операции, запросы подтверждения и скидки
+    setRightsChecks( operItem_, rights, ProfileRights::Opers );
+    setRightsChecks( requestItem_, rights, ProfileRights::Opers );
+    setRightsChecks( discountItem_, rights, ProfileRights::Opers );
 
     // оплата
-    jMap = QJsonDocument::fromJson( ui_->profileTable->item( row, PAYS_PROFILE_INDEX )->text().toLocal8Bit() ).toVariant().toMap();
-    for ( int x = 0; x < payItem_->childCount(); ++x ) {
-        if ( jMap.contains( payItem_->child( x )->data( 0, Qt::UserRole ).toString() ) == true )
-            chState = jMap[ payItem_->child( x )->data( 0, Qt::UserRole ).toString() ].toBool() ? Qt::Checked : Qt::Unchecked;
-        else
-            chState = Qt::Checked;
-        payItem_->child( x )->setCheckState( 0, chState );
-    }
+    setRightsChecks( payItem_, rights, ProfileRights::Pays );
 
     // кассовые отчеты
-    jMap = QJsonDocument::fromJson( ui_->profileTable->item( row, REPORTS_PROFILE_INDEX )->text().toLocal8Bit() ).toVariant().toMap();
-    for ( int x = 0; x < reportItem_->childCount(); ++x ) {
-        if ( jMap.contains( reportItem_->child( x )->data( 0, Qt::UserRole ).toString() ) == true )
-            chState = jMap[ reportItem_->child( x )->data( 0, Qt::UserRole ).toString() ].toBool() ? Qt::Checked : Qt::Unchecked;
-        else
-            chState = Qt::Checked;
-        reportItem_->child( x )->setCheckState( 0, chState );
-    }
+    setRightsChecks( reportItem_, rights, ProfileRights::Reports );
 
     // горячие клавиши
     ui_->keyTree->setCurrentItem( NULL );
     ui_->keyTree->blockSignals( true );
 
-    if ( ui_->profileTable->item( row, HOTKEYS_PROFILE_INDEX ) )
-        setKeyMap( QJsonDocument::fromJson( ui_->profileTable->item( row, HOTKEYS_PROFILE_INDEX )->text().toLocal8Bit() ).toVariant().toMap() );
+    if ( model_->text( row, HOTKEYS_PROFILE_INDEX ) != "" )
+        setKeyMap( QJsonDocument::fromJson( model_->text( row, HOTKEYS_PROFILE_INDEX ).toLocal8Bit() ).toVariant().toMap() );
     ui_->keyTree->blockSignals( false );
 
     ui_->tree->blockSignals( false );
 }
 
+void GProfileForm::setRightsChecks( QTreeWidgetItem *parent, const ProfileRights &rights, int section )
+{
+    for ( int x = 0; x < parent->childCount(); ++x ) {
+        bool allowed = rights.allowed( ProfileRights::Section( section ), parent->child( x )->data( 0, Qt::UserRole ).toInt() );
+
+        parent->child( x )->setCheckState( 0, allowed ? Qt::Checked : Qt::Unchecked );
+    }
+}
+
 void GProfileForm::clearEdits()
 {
     ui_->profileEdit->clear();
@@ -382,7 +350,7 @@ void GProfileForm::onAddProfile()
 
 void GProfileForm::onEditProfile()
 {
-    if ( ui_->profileTable->currentRow() < 0 )
+    if ( currentRow() < 0 )
         return;
 
     if ( workMode_ == GProfileForm::wmView ) {
@@ -394,16 +362,19 @@ void GProfileForm::onEditProfile()
 void GProfileForm::onDeleteProfile()
 {
     QVariantMap vMap;
+    QString id;
 
-    if ( ui_->profileTable->currentRow() < 0 )
+    if ( currentRow() < 0 )
         return;
 
     if ( showQuestion( trUtf8( "Удаление" ), trUtf8( "Удалить текущий профиль?" ), this ) == false )
         return;
 
-    vMap[ ID_USER_PROFILE ] = ui_->profileTable->item( ui_->profileTable->currentRow(), ID_PROFILE_INDEX )->text();
+    id = model_->text( currentRow(), ID_PROFILE_INDEX );
+    vMap[ ID_USER_PROFILE ] = id;
     if ( storage_->deleteTableRowData( USERS_PROFILE_TABLE, vMap, false ) == true ) {
         gLogManager->addUserMessage( trUtf8( "Удаление профиля пользователя " ) + ui_->profileEdit->text()  );
+        model_->removeProfile( id );
         showProfile();
     }
     else
@@ -438,6 +409,38 @@ void GProfileForm::setKeyMap( QVariantMap kMap )
             ui_->keyTree->topLevelItem( x )->child( y )->setText( KT_HOTKEY_INDEX, key );
         }
     }
+
+    checkHotKeys();
+}
+
+// одно сочетание у нескольких действий подсвечивается сразу
+void GProfileForm::checkHotKeys()
+{
+    QHash< int, QString > nameMap;
+    bool blocked;
+
+    hotKeys_.compile( getKeyMap() );
+
+    for( int x = 0; x < ui_->keyTree->topLevelItemCount(); ++x ) {
+        for( int y = 0; y < ui_->keyTree->topLevelItem( x )->childCount(); ++y )
+            nameMap[ ui_->keyTree->topLevelItem( x )->child( y )->data( 0, Qt::UserRole ).toInt() ] = ui_->keyTree->topLevelItem( x )->child( y )->text( 0 );
+    }
+
+    blocked = ui_->keyTree->blockSignals( true );
+    for( int x = 0; x < ui_->keyTree->topLevelItemCount(); ++x ) {
+        for( int y = 0; y < ui_->keyTree->topLevelItem( x )->childCount(); ++y ) {
+            QTreeWidgetItem *item = ui_->keyTree->topLevelItem( x )->child( y );
+            int id = item->data( 0, Qt::UserRole ).toInt();
+            QStringList nameList;
+
+            foreach( int other, hotKeys_.conflicts( id ) )
+                nameList << nameMap.value( other );
+
+            item->setForeground( KT_HOTKEY_INDEX, nameList.isEmpty() ? QBrush() : QBrush( Qt::red ) );
+            item->setToolTip( KT_HOTKEY_INDEX, nameList.isEmpty() ? "" : trUtf8( "Совпадает с: " ) + nameList.join( ", " ) );
+        }
+    }
+    ui_->keyTree->blockSignals( blocked );
 }
 
 void GProfileForm::onSaveProfile()
@@ -445,8 +448,11 @@ void GProfileForm::onSaveProfile()
     QVariantList vList;
     QVariantMap vMap;
     QVariantMap jMap;
+    QStringList values;
+    QVariant id;
+    int row = -1;
 
-    if ( ui_->profileTable->currentRow() < 0 && workMode_ == GProfileForm::wmEdit )
+    if ( currentRow() < 0 && workMode_ == GProfileForm::wmEdit )
         return;
 
     // проверка на правильнось вводимых значений
@@ -457,8 +463,16 @@ void GProfileForm::onSaveProfile()
         return;
     }
 
+    if ( hotKeys_.hasConflicts() == true ) {
+        showWarning( workMode_ == GProfileForm::wmAdd ? trUtf8( "Добавление" ) : trUtf8( "Редактирование" ),
+                     trUtf8( "Одно сочетание клавиш назначено нескольким действиям одной группы" ),
+                     this );
+        return;
+    }
+
     vMap[ NAME_USER_PROFILE ] = ui_->profileEdit->text().replace( "'", "''" );
     vList << vMap;
+    values << "" << ui_->profileEdit->text();
     if (ui_->profileEdit->property( "profile" ).toString() == gProfileUser )
         gProfileUser = ui_->profileEdit->text();
 
@@ -468,6 +482,7 @@ void GProfileForm::onSaveProfile()
 
     vMap[ FORMS_PROFILE ] = QJsonDocument::fromVariant( jMap ).toJson();
     vList << vMap;
+    values << vMap[ FORMS_PROFILE ].toString();
 
     // операции
     jMap.clear();
@@ -485,6 +500,7 @@ void GProfileForm::onSaveProfile()
     vMap.clear();
     vMap[ OPERS_PROFILE ] = QJsonDocument::fromVariant( jMap ).toJson();
     vList << vMap;
+    values << vMap[ OPERS_PROFILE ].toString();
 
     // оплата
     jMap.clear();
@@ -494,6 +510,7 @@ void GProfileForm::onSaveProfile()
     vMap.clear();
     vMap[ PAYS_PROFILE ] = QJsonDocument::fromVariant( jMap ).toJson();
     vList << vMap;
+    values << vMap[ PAYS_PROFILE ].toString();
 
     // кассовые отчеты
     jMap.clear();
@@ -503,23 +520,44 @@ void GProfileForm::onSaveProfile()
     vMap.clear();
     vMap[ REPORTS_PROFILE ] = QJsonDocument::fromVariant( jMap ).toJson();
     vList << vMap;
+    values << vMap[ REPORTS_PROFILE ].toString();
 
     // горячие клавиши
     vMap.clear();
     vMap[ HOTKEYS_PROFILE ] = QJsonDocument::fromVariant( getKeyMap() ).toJson();
     vList << vMap;
-
-    if ( workMode_ == GProfileForm::wmAdd )
-        storage_->addTableRowData( USERS_PROFILE_TABLE, vList );
+    values << vMap[ HOTKEYS_PROFILE ].toString();
+
+    // в таблице меняется только сохраненная строка
+    if ( workMode_ == GProfileForm::wmAdd ) {
+        // только положительное число - ID новой записи
+        id = storage_->addTableRowData( USERS_PROFILE_TABLE, vList );
+        if ( id.toLongLong() > 0 ) {
+            values[ ID_PROFILE_INDEX ] = id.toString();
+            row = model_->addProfile( values );
+        }
+        else {
+            // ID новой записи неизвестен, перечитываем таблицу
+            model_->load();
+            row = model_->findName( ui_->profileEdit->text() );
+        }
+    }
 
     if ( workMode_ == GProfileForm::wmEdit ) {
+        values[ ID_PROFILE_INDEX ] = model_->text( currentRow(), ID_PROFILE_INDEX );
         vMap.clear();
-        vMap[ ID_USER_PROFILE ] = ui_->profileTable->item( ui_->profileTable->currentRow(), ID_PROFILE_INDEX )->text();
-        storage_->updateTableRowData( USERS_PROFILE_TABLE, vList, vMap );
+        vMap[ ID_USER_PROFILE ] = values[ ID_PROFILE_INDEX ];
+        // строка меняется, только если запись в базе изменилась
+        if ( storage_->updateTableRowData( USERS_PROFILE_TABLE, vList, vMap ) == true )
+            row = model_->updateProfile( values );
+        else {
+            showWarning( trUtf8( "Редактирование" ), trUtf8( "Ошибка сохранения профиля пользователя" ), this );
+            row = currentRow();
+        }
     }
 
     workMode_ = GProfileForm::wmView;
-    showProfile( ui_->profileEdit->text() );
+    showProfile( row );
 }
 
 void GProfileForm::onCancelProfile()
@@ -527,7 +565,7 @@ void GProfileForm::onCancelProfile()
     workMode_ = GProfileForm::wmView;
     setControls();
 
-    onCellClicked( ui_->profileTable->currentRow(), 0 );
+    onCellClicked( currentRow(), 0 );
 }
 
 void GProfileForm::closeEvent( QCloseEvent *e )
@@ -585,6 +623,8 @@ void GProfileForm::onKeyChanged( const QString &text )
 
     ui_->keyTree->currentItem()->setText( KT_HOTKEY_INDEX, text );
     ui_->clearBtn->setVisible( keyEdit_->text() != "" );
+
+    checkHotKeys();
 }
 
 void GProfileForm::onClearKey()
@@ -604,7 +644,7 @@ void GProfileForm::onResetKey()
          ui_->keyTree->currentItem()->data( 0, Qt::UserRole ).isValid() == false )
         return;
 
-    kMap = BA2Variant( qUncompress( QByteArray::fromHex( ui_->profileTable->item( ui_->profileTable->currentRow(), HOTKEYS_PROFILE_INDEX )->text().toLocal8Bit() ) ) ).toMap();
+    kMap = BA2Variant( qUncompress( QByteArray::fromHex( model_->text( currentRow(), HOTKEYS_PROFILE_INDEX ).toLocal8Bit() ) ) ).toMap();
 
     keyEdit_->setText( kMap[ ui_->keyTree->currentItem()->data( 0, Qt::UserRole ).toString() ].toString() );
 }
@@ -616,6 +656,8 @@ void GProfileForm::onDefaultKey()
             ui_->keyTree->topLevelItem( x )->child( y )->setText( KT_HOTKEY_INDEX,
                                                                   findHotKey( ui_->keyTree->topLevelItem( x )->child( y )->data( 0, Qt::UserRole ).toInt(), true ) );
     }
+
+    checkHotKeys();
 }
 
 void GProfileForm::onExportKey()
@@ -667,20 +709,19 @@ void GProfileForm::onImportKey()
     }
 }
 
-void GProfileForm::onCellDoubleClicked ( int row, int column )
+void GProfileForm::onCellDoubleClicked ( const QModelIndex &index )
 {
-    Q_UNUSED( row )
-    Q_UNUSED( column )
+    Q_UNUSED( index )
 
     accept();
 }
 
 QVariant GProfileForm::getSelectedProfile()
 {
-    if ( ui_->profileTable->currentRow() < 0 )
+    if ( currentRow() < 0 )
         return QVariant();
 
-    return QVariant( ui_->profileTable->item( ui_->profileTable->currentRow(), 0 )->text() );
+    return QVariant( model_->text( currentRow(), ID_PROFILE_INDEX ) );
 }
 
 void GProfileForm::contextMenuEvent ( QContextMenuEvent *event )
@@ -693,33 +734,40 @@ void GProfileForm::contextMenuEvent ( QContextMenuEvent *event )
 //=============================================================================
 // class GKeyEdit
 //=============================================================================
+GKeyEdit::GKeyEdit( QWidget *parent ) : QLineEdit( parent )
+{
+    editing_ = false;
+
+    connect( this, SIGNAL( textChanged( QString ) ), this, SLOT( onTextChanged( QString ) ) );
+}
+
 void GKeyEdit::keyPressEvent( QKeyEvent *e )
 {
-    bool isShiftPressed = e->modifiers() & Qt::ShiftModifier;
-    bool isControlPressed = e->modifiers() & Qt::ControlModifier;
-    bool isAltPressed = e->modifiers() & Qt::AltModifier;
-    bool isMetaPressed = e->modifiers() & Qt::MetaModifier;
-    int result = 0;
-    if( isControlPressed )
-      result += Qt::CTRL;
-    if( isAltPressed )
-      result += Qt::ALT;
-    if( isShiftPressed )
-      result += Qt::SHIFT;
-    if( isMetaPressed )
-      result += Qt::META;
-
-    int aKey = e->key();
-
-    if ( isValidKey( aKey ) ) {
-        result += e->key();
-
-        QKeySequence seq( result );
-        if ( text().split( ", " ).contains( seq.toString() ) == false )
-            setText( ( text() == "" ? "" : text() + ", " ) + seq.toString() );
+    if ( isValidKey( e->key() ) ) {
+        int result = GHotKeyIndex::keyCode( e );
+
+        if ( keys_.contains( result ) == false ) {
+            keys_ << result;
+
+            editing_ = true;
+            setText( ( text() == "" ? "" : text() + ", " ) + QKeySequence( result ).toString() );
+            editing_ = false;
+        }
     }
 }
 
+// текст задан извне, набор сочетаний строится заново
+void GKeyEdit::onTextChanged( const QString &text )
+{
+    QList< int > keyList;
+
+    if ( editing_ == true )
+        return;
+
+    keyList = GHotKeyIndex::parseKeys( text );
+    keys_ = QSet< int >( keyList.begin(), keyList.end() );
+}
+
 bool GKeyEdit::isValidKey( int aKey )
 {
    if ( aKey == Qt::Key_Underscore || aKey == Qt::Key_Escape ||
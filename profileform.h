@@ -4,6 +4,9 @@
 #include <QDialog>
 #include <QVariant>
 #include <QLineEdit>
+#include <QSet>
+
+#include "hotkeyindex.h"
 
 namespace Ui {
     class ProfileForm;
@@ -13,6 +16,9 @@ class GStorage;
 class QTreeWidgetItem;
 class GKeyEdit;
 class QMenu;
+class ProfileRights;
+class GProfileModel;
+class QModelIndex;
 
 class GProfileForm : public QDialog
 {
@@ -38,8 +44,8 @@ private slots:
     void onSaveProfile();
     void onCancelProfile();
 
-    void onCellClicked( int row, int column, int previousRow = -1, int previousColumn = -1 );
-    void onCellDoubleClicked ( int row, int column );
+    void onCurrentRowChanged( const QModelIndex &current, const QModelIndex &previous );
+    void onCellDoubleClicked ( const QModelIndex &index );
 
     void onKeyTreeClicked( QTreeWidgetItem *item, int );
     void onKeyChanged( const QString &text );
@@ -57,6 +63,7 @@ protected:
 private:
     Ui::ProfileForm *ui_;
     GStorage *storage_;
+    GProfileModel *model_;
     WorkMode workMode_;
     GKeyEdit *keyEdit_;
     QMenu *contextMenu_;
@@ -71,15 +78,21 @@ private:
     QTreeWidgetItem *requestItem_;
     QTreeWidgetItem *discountItem_;
 
+    GHotKeyIndex hotKeys_;
+
     void clearEdits();
     void setControls();
-    void showProfile( const QString &profile = "" );
+    void showProfile( int row = -1 );
+    int currentRow() const;
+    void onCellClicked( int row, int column, int previousRow = -1, int previousColumn = -1 );
+    void setRightsChecks( QTreeWidgetItem *parent, const ProfileRights &rights, int section );
 
     void initRighTree();
     void initKeyTree();
 
     QVariantMap getKeyMap();
     void setKeyMap( QVariantMap kMap );
+    void checkHotKeys();
 };
 
 class GKeyEdit : public QLineEdit
@@ -87,12 +100,18 @@ class GKeyEdit : public QLineEdit
     Q_OBJECT
 
 public:
-    GKeyEdit( QWidget *parent = 0 ) : QLineEdit( parent ) {}
+    GKeyEdit( QWidget *parent = 0 );
 
 protected:
     void keyPressEvent( QKeyEvent *event );
 
+private slots:
+    void onTextChanged( const QString &text );
+
 private:
+    QSet< int > keys_;  // сочетания из text()
+    bool editing_;
+
     bool isValidKey( int );
 };
 
@@ -0,0 +1,135 @@
+#include "profilemodel.h"
+#include "defines.h"
+#include "tablecolumns.h"
+
+GProfileModel::GProfileModel( GStorage *st, QObject *parent ) : QAbstractTableModel( parent )
+{
+    storage_ = st;
+}
+
+// полная загрузка, только при открытии формы
+void GProfileModel::load()
+{
+    GTableColumns profiles;
+    QList< int > columns;
+
+    for ( int x = 0; x < PROFILE_COLUMN_COUNT; ++x )
+        columns << x;
+
+    beginResetModel();
+    rows_.clear();
+    index_.clear();
+
+    getTableColumns( storage_, USERS_PROFILE_TABLE, profiles, columns );
+    rows_.reserve( profiles.rowCount() );
+    for ( int x = 0; x < profiles.rowCount(); ++x ) {
+        QStringList dataList;
+
+        for ( int y = 0; y < PROFILE_COLUMN_COUNT; ++y )
+            dataList << profiles.text( x, y );
+
+        index_[ dataList.value( ID_PROFILE_INDEX ) ] = x;
+        rows_ << dataList;
+    }
+
+    endResetModel();
+}
+
+int GProfileModel::rowCount( const QModelIndex &parent ) const
+{
+    return parent.isValid() ? 0 : rows_.count();
+}
+
+int GProfileModel::columnCount( const QModelIndex &parent ) const
+{
+    return parent.isValid() ? 0 : PROFILE_COLUMN_COUNT;
+}
+
+QVariant GProfileModel::data( const QModelIndex &index, int role ) const
+{
+    if ( index.isValid() == false || role != Qt::DisplayRole )
+        return QVariant();
+
+    return text( index.row(), index.column() );
+}
+
+QVariant GProfileModel::headerData( int section, Qt::Orientation orientation, int role ) const
+{
+    if ( orientation != Qt::Horizontal || role != Qt::DisplayRole )
+        return QAbstractTableModel::headerData( section, orientation, role );
+
+    if ( section == NAME_PROFILE_INDEX )
+        return trUtf8( "Профиль" );
+
+    return QVariant();
+}
+
+QString GProfileModel::text( int row, int column ) const
+{
+    if ( row < 0 || row >= rows_.count() )
+        return QString();
+
+    return rows_[ row ].value( column );
+}
+
+int GProfileModel::findRow( const QString &id ) const
+{
+    return index_.value( id, -1 );
+}
+
+int GProfileModel::findName( const QString &name ) const
+{
+    for ( int x = 0; x < rows_.count(); ++x ) {
+        if ( rows_[ x ].value( NAME_PROFILE_INDEX ) == name )
+            return x;
+    }
+
+    return -1;
+}
+
+// новая строка в конец таблицы, как ее вернул бы запрос
+int GProfileModel::addProfile( const QStringList &values )
+{
+    int row = rows_.count();
+
+    beginInsertRows( QModelIndex(), row, row );
+    rows_ << values;
+    index_[ values.value( ID_PROFILE_INDEX ) ] = row;
+    endInsertRows();
+
+    return row;
+}
+
+int GProfileModel::updateProfile( const QStringList &values )
+{
+    int row = findRow( values.value( ID_PROFILE_INDEX ) );
+
+    if ( row < 0 )
+        return addProfile( values );
+
+    rows_[ row ] = values;
+    emit dataChanged( index( row, 0 ), index( row, PROFILE_COLUMN_COUNT - 1 ) );
+
+    return row;
+}
+
+void GProfileModel::removeProfile( const QString &id )
+{
+    int row = findRow( id );
+
+    if ( row < 0 )
+        return;
+
+    beginRemoveRows( QModelIndex(), row, row );
+    rows_.removeAt( row );
+    index_.remove( id );
+    reindex( row );
+    endRemoveRows();
+}
+
+// строки после удаленной сдвинулись на одну вверх
+void GProfileModel::reindex( int from )
+{
+    for ( int x = from; x < rows_.count(); ++x )
+        index_[ rows_[ x ].value( ID_PROFILE_INDEX ) ] = x;
+}
@@ -0,0 +1,52 @@
+#ifndef PROFILEMODEL_H
+#define PROFILEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QStringList>
+#include <QHash>
+
+#define ID_PROFILE_INDEX        0
+#define NAME_PROFILE_INDEX      1
+#define FORMS_PROFILE_INDEX     2
+#define OPERS_PROFILE_INDEX     3
+#define PAYS_PROFILE_INDEX      4
+#define REPORTS_PROFILE_INDEX   5
+#define HOTKEYS_PROFILE_INDEX   6
+
+#define PROFILE_COLUMN_COUNT    7
+
+class GStorage;
+
+// Профили пользователей. Таблица читается из базы один раз, после
+// добавления, изменения и удаления меняется только одна строка.
+class GProfileModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    GProfileModel( GStorage *st, QObject *parent = 0 );
+
+    void load();
+
+    int rowCount( const QModelIndex &parent = QModelIndex() ) const;
+    int columnCount( const QModelIndex &parent = QModelIndex() ) const;
+    QVariant data( const QModelIndex &index, int role = Qt::DisplayRole ) const;
+    QVariant headerData( int section, Qt::Orientation orientation, int role = Qt::DisplayRole ) const;
+
+    QString text( int row, int column ) const;
+    int findRow( const QString &id ) const;
+    int findName( const QString &name ) const;
+
+    int addProfile( const QStringList &values );
+    int updateProfile( const QStringList &values );
+    void removeProfile( const QString &id );
+
+private:
+    GStorage *storage_;
+    QList< QStringList > rows_;
+    QHash< QString, int > index_;   // ID профиля -> строка
+
+    void reindex( int from );
+};
+
+#endif // PROFILEMODEL_H
@@ -0,0 +1,153 @@
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "profilerights.h"
+#include "defines.h"
+
+// posted by the trigger on the profiles table
+#define EVENT_PROFILES_CHANGED  "RP_PROFILES_CHANGED"
+
+// JSON columns of a profile row, and the sections of the compiled rights
+static const char *const SECTION_KEYS[ProfileRights::SectionCount] = {
+    "forms",
+    "opers",
+    "pays",
+    "reports"
+};
+
+ProfileRights ProfileRights::compile(const QVariantMap &profile)
+{
+    ProfileRights rights;
+    QList<int> opersOff;
+
+    // the operations a profile without a word on them doesn't get
+    opersOff << UO_SALE_GROUP << UO_SORT_RECEIPT_COLUMN << UO_FILTER_DISABLED_ART;
+
+    for (int x = 0; x < SectionCount; ++x)
+        rights.bits_[x] = compileSection(profile.value(SECTION_KEYS[x]).toString(),
+                                         x == Opers ? opersOff : QList<int>());
+
+    return rights;
+}
+
+// Every id named in the JSON gets its value, the defaults fill the rest.
+QBitArray ProfileRights::compileSection(const QString &json, const QList<int> &deniedByDefault)
+{
+    QJsonObject object = QJsonDocument::fromJson(json.toUtf8()).object();
+    QHash<int, bool> named;
+    QBitArray bits;
+    int size = 0;
+
+    for (QJsonObject::const_iterator it = object.constBegin(); it != object.constEnd(); ++it) {
+        bool ok;
+        int id = it.key().toInt(&ok);
+
+        if (ok == true && id >= 0) {
+            named.insert(id, it.value().toBool());
+            size = qMax(size, id + 1);
+        }
+    }
+
+    foreach (int id, deniedByDefault)
+        size = qMax(size, id + 1);
+
+    bits.resize(size);
+    bits.fill(true);
+
+    foreach (int id, deniedByDefault)
+        bits.clearBit(id);
+
+    for (QHash<int, bool>::const_iterator it = named.constBegin(); it != named.constEnd(); ++it)
+        bits.setBit(it.key(), it.value());
+
+    return bits;
+}
+
+// Each section as base64 of its bits, bit n of the stream for id n, low
+// bit of every byte first, so both protocols carry it as a short string.
+QVariantMap ProfileRights::toMap() const
+{
+    QVariantMap map;
+
+    for (int x = 0; x < SectionCount; ++x) {
+        const QBitArray &bits = bits_[x];
+        QByteArray bytes = QByteArray::fromRawData(bits.bits(), (bits.size() + 7) / 8);
+
+        map[SECTION_KEYS[x]] = QString::fromLatin1(bytes.toBase64());
+        map[QString(SECTION_KEYS[x]) + "_size"] = bits.size();
+    }
+
+    return map;
+}
+
+ProfileRights ProfileRights::fromMap(const QVariantMap &map)
+{
+    ProfileRights rights;
+
+    for (int x = 0; x < SectionCount; ++x) {
+        QByteArray bytes = QByteArray::fromBase64(map.value(SECTION_KEYS[x]).toString().toLatin1());
+        int size = qMin(map.value(QString(SECTION_KEYS[x]) + "_size").toInt(), bytes.size() * 8);
+
+        rights.bits_[x] = QBitArray::fromBits(bytes.constData(), qMax(size, 0));
+    }
+
+    return rights;
+}
+
+//=============================================================================
+// class ProfileRightsCache
+//=============================================================================
+ProfileRightsCache::ProfileRightsCache(QObject *parent) : QObject(parent),
+    generation_(1)
+{
+}
+
+QString ProfileRightsCache::eventName()
+{
+    return EVENT_PROFILES_CHANGED;
+}
+
+bool ProfileRightsCache::find(const QString &profileId, QVariantMap &rights) const
+{
+    QReadLocker locker(&lock_);
+    QHash<QString, QVariantMap>::const_iterator it = profiles_.constFind(profileId);
+
+    if (it == profiles_.constEnd())
+        return false;
+
+    rights = it.value();
+    return true;
+}
+
+quint64 ProfileRightsCache::generation() const
+{
+    QReadLocker locker(&lock_);
+
+    return generation_;
+}
+
+void ProfileRightsCache::insert(const QString &profileId, quint64 generation, const QVariantMap &rights)
+{
+    QWriteLocker locker(&lock_);
+
+    // the profile changed while it was being compiled
+    if (generation != generation_)
+        return;
+
+    profiles_.insert(profileId, rights);
+}
+
+void ProfileRightsCache::clear()
+{
+    QWriteLocker locker(&lock_);
+
+    generation_++;
+    profiles_.clear();
+}
+
+// The generator poll reports any change with an empty name.
+void ProfileRightsCache::onDbEvent(const QString &name)
+{
+    if (name.isEmpty() == true || name == EVENT_PROFILES_CHANGED)
+        clear();
+}
@@ -0,0 +1,73 @@
+#ifndef PROFILERIGHTS_H
+#define PROFILERIGHTS_H
+
+#include <QObject>
+#include <QBitArray>
+#include <QHash>
+#include <QVariant>
+#include <QReadWriteLock>
+
+// The rights of one user profile compiled from its JSON columns into a
+// bitset per section, indexed by the form, operation, payment type and
+// report ids. The default of every right the profile doesn't mention is
+// resolved when compiling, so a check is a single bit test. Ids past the
+// end of a bitset are allowed, as unmentioned rights are by default.
+class ProfileRights
+{
+public:
+    enum Section {
+        Forms,
+        Opers,
+        Pays,
+        Reports,
+        SectionCount
+    };
+
+    ProfileRights() {}
+
+    static ProfileRights compile(const QVariantMap &profile);
+    static ProfileRights fromMap(const QVariantMap &map);
+
+    bool allowed(Section section, int id) const
+    {
+        const QBitArray &bits = bits_[section];
+
+        return id < 0 || id >= bits.size() || bits.testBit(id);
+    }
+
+    QVariantMap toMap() const;
+
+private:
+    QBitArray bits_[SectionCount];
+
+    static QBitArray compileSection(const QString &json, const QList<int> &deniedByDefault);
+};
+
+// Compiled rights keyed by profile id, dropped when a profile changes.
+// The server clears it whole when the catalog events are lost and again
+// when they are subscribed again, a change in between goes unseen.
+// Logins read it from every worker.
+class ProfileRightsCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ProfileRightsCache(QObject *parent = 0);
+
+    static QString eventName();
+
+    bool find(const QString &profileId, QVariantMap &rights) const;
+    quint64 generation() const;
+    void insert(const QString &profileId, quint64 generation, const QVariantMap &rights);
+
+public Q_SLOTS:
+    void clear();
+    void onDbEvent(const QString &name);
+
+private:
+    mutable QReadWriteLock lock_;
+    quint64 generation_;
+    QHash<QString, QVariantMap> profiles_;
+};
+
+#endif // PROFILERIGHTS_H
@@ -0,0 +1,348 @@
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QCborValue>
+#include <QCborMap>
+#include <cstring>
+#include <QThreadStorage>
+#include <QtEndian>
+
+#include "request.h"
+#include "jsonwriter.h"
+#include "serverstats.h"
+
+// per thread output buffer, keeps the capacity of the largest response
+static QThreadStorage<QByteArray> encodeBuffers;
+
+// CBOR major type of maps
+static const uchar CBOR_MAP = 5;
+
+static void appendCborHead(QByteArray &out, uchar major, quint64 value)
+{
+    uchar head = uchar(major << 5);
+
+    if (value < 24)
+        out.append(char(head | value));
+    else if (value <= 0xff) {
+        out.append(char(head | 24));
+        out.append(char(value));
+    }
+    else if (value <= 0xffff) {
+        out.append(char(head | 25));
+        out.append(char(value >> 8)).append(char(value));
+    }
+    else {
+        out.append(char(head | 26));
+        for (int shift = 24; shift >= 0; shift -= 8)
+            out.append(char(value >> shift));
+    }
+}
+
+static int skipSpace(const char *data, int pos, int size)
+{
+    while (pos < size && (data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\n' || data[pos] == '\r'))
+        pos++;
+
+    return pos;
+}
+
+// Position after the string opening at pos, -1 when it is not closed.
+static int skipString(const char *data, int pos, int size)
+{
+    for (++pos; pos < size; ++pos) {
+        if (data[pos] == '\\')
+            ++pos;
+        else if (data[pos] == '"')
+            return pos + 1;
+    }
+
+    return -1;
+}
+
+// Position after the value starting at pos, -1 when it is cut short. The
+// value is only delimited here, not checked.
+static int skipValue(const char *data, int pos, int size)
+{
+    int start = pos;
+    int depth = 0;
+
+    if (pos >= size)
+        return -1;
+
+    if (data[pos] == '"')
+        return skipString(data, pos, size);
+
+    if (data[pos] == '{' || data[pos] == '[') {
+        while (pos < size) {
+            if (data[pos] == '"') {
+                pos = skipString(data, pos, size);
+                if (pos < 0)
+                    return -1;
+                continue;
+            }
+
+            if (data[pos] == '{' || data[pos] == '[')
+                depth++;
+            else if ((data[pos] == '}' || data[pos] == ']') && --depth == 0)
+                return pos + 1;
+            pos++;
+        }
+
+        return -1;
+    }
+
+    while (pos < size && std::strchr(",}] \t\r\n", data[pos]) == 0)
+        pos++;
+
+    return pos > start ? pos : -1;
+}
+
+Request::Request(ConnectionShard *shard, QWebSocket *socket, quint64 connectionId, Protocol protocol,
+                 const QByteArray &message) :
+    shard_(shard),
+    socket_(socket),
+    connectionId_(connectionId),
+    protocol_(protocol),
+    valid_(false)
+{
+    if (protocol_ == Request::Cbor) {
+        QCborValue cbor = QCborValue::fromCbor(message);
+
+        if (cbor.isMap() == true) {
+            cbor_ = cbor.toMap();
+            valid_ = true;
+        }
+    }
+    else {
+        message_ = message;
+        valid_ = index();
+        if (valid_ == false)
+            message_.clear();
+    }
+}
+
+Request::Request(ConnectionShard *shard, QWebSocket *socket, quint64 connectionId, Protocol protocol,
+                 const QJsonObject &json) :
+    shard_(shard),
+    socket_(socket),
+    connectionId_(connectionId),
+    protocol_(protocol),
+    valid_(true),
+    json_(json)
+{
+}
+
+// Finds every top-level field of the JSON frame without decoding any
+// value, false when the frame is not one object.
+bool Request::index()
+{
+    const char *data = message_.constData();
+    int size = message_.size();
+    int pos = skipSpace(data, 0, size);
+
+    if (pos >= size || data[pos] != '{')
+        return false;
+
+    pos = skipSpace(data, pos + 1, size);
+    if (pos < size && data[pos] == '}')
+        return skipSpace(data, pos + 1, size) == size;
+
+    for (;;) {
+        Field field;
+
+        if (pos >= size || data[pos] != '"')
+            return false;
+
+        field.key = pos + 1;
+        pos = skipString(data, pos, size);
+        if (pos < 0)
+            return false;
+        field.keySize = pos - 1 - field.key;
+
+        pos = skipSpace(data, pos, size);
+        if (pos >= size || data[pos] != ':')
+            return false;
+
+        field.value = skipSpace(data, pos + 1, size);
+        pos = skipValue(data, field.value, size);
+        if (pos < 0)
+            return false;
+        field.valueSize = pos - field.value;
+        fields_.append(field);
+
+        pos = skipSpace(data, pos, size);
+        if (pos < size && data[pos] == ',')
+            pos = skipSpace(data, pos + 1, size);
+        else if (pos < size && data[pos] == '}')
+            return skipSpace(data, pos + 1, size) == size;
+        else
+            return false;
+    }
+}
+
+// The last field of that name, as a JSON parser would keep. Keys are
+// compared as written, escaped keys never match.
+const Request::Field *Request::field(const QString &key) const
+{
+    QByteArray name = key.toUtf8();
+
+    for (int x = fields_.size() - 1; x >= 0; --x) {
+        const Field &field = fields_[x];
+
+        if (field.keySize == name.size() && std::memcmp(message_.constData() + field.key, name.constData(), name.size()) == 0)
+            return &field;
+    }
+
+    return 0;
+}
+
+// The command name as UTF-8, pointing into the frame when it is a plain
+// string. Only valid while the request lives.
+QByteArray Request::cmdName() const
+{
+    if (message_.isEmpty() == false) {
+        const Field *cmd = field("cmd");
+
+        if (cmd && message_.at(cmd->value) == '"'
+                && std::memchr(message_.constData() + cmd->value, '\\', cmd->valueSize) == 0)
+            return QByteArray::fromRawData(message_.constData() + cmd->value + 1, cmd->valueSize - 2);
+    }
+
+    return cmd().toUtf8();
+}
+
+QString Request::cmd() const
+{
+    return value("cmd").toString();
+}
+
+bool Request::contains(const QString &key) const
+{
+    if (message_.isEmpty() == false)
+        return field(key) != 0;
+    if (cbor_.isEmpty() == false)
+        return cbor_.contains(key);
+
+    return json_.contains(key);
+}
+
+// Decodes just this field. Strings without escapes are taken from the
+// frame as they are, anything else goes through the JSON parser alone.
+QJsonValue Request::value(const QString &key) const
+{
+    if (message_.isEmpty() == false) {
+        const Field *found = field(key);
+        const char *data;
+        QJsonDocument doc;
+
+        if (!found)
+            return QJsonValue(QJsonValue::Undefined);
+
+        data = message_.constData() + found->value;
+        if (data[0] == '"' && std::memchr(data, '\\', found->valueSize) == 0)
+            return QJsonValue(QString::fromUtf8(data + 1, found->valueSize - 2));
+
+        doc = QJsonDocument::fromJson(QByteArray(1, '[') + QByteArray::fromRawData(data, found->valueSize) + ']');
+        return doc.isArray() ? doc.array().at(0) : QJsonValue(QJsonValue::Undefined);
+    }
+
+    if (cbor_.isEmpty() == false) {
+        if (cbor_.contains(key) == false)
+            return QJsonValue(QJsonValue::Undefined);
+        return cbor_.value(key).toJsonValue();
+    }
+
+    return json_.value(key);
+}
+
+QByteArray Request::encode(const QVariantMap &map) const
+{
+    return encode(map, protocol_);
+}
+
+QByteArray Request::encode(const QVariantMap &map, Protocol protocol)
+{
+    ServerStats::Span span(ServerStats::Serialize);
+
+    if (protocol == Request::Cbor)
+        return QCborMap::fromVariantMap(map).toCborValue().toCbor();
+
+    QByteArray &buffer = encodeBuffers.localData();
+    JsonWriter writer(buffer);
+
+    // the reply leaves the thread, it gets one copy of its exact size and
+    // the buffer keeps its capacity for the next one
+    writer.writeMap(map);
+
+    return QByteArray(buffer.constData(), buffer.size());
+}
+
+// Adds the request's "req_id" as the first field of an encoded reply
+// map, without decoding the reply.
+QByteArray Request::tag(const QByteArray &reply) const
+{
+    QByteArray result;
+
+    if (contains("req_id") == false || reply.isEmpty() == true)
+        return reply;
+
+    if (protocol_ == Request::Cbor) {
+        const uchar *data = reinterpret_cast<const uchar *>(reply.constData());
+        uchar info = data[0] & 0x1f;
+        quint64 count;
+        int head;
+
+        if ((data[0] >> 5) != CBOR_MAP)
+            return reply;
+
+        if (info < 24) {
+            count = info;
+            head = 1;
+        }
+        else if (info == 24 && reply.size() > 1) {
+            count = data[1];
+            head = 2;
+        }
+        else if (info == 25 && reply.size() > 2) {
+            count = qFromBigEndian<quint16>(data + 1);
+            head = 3;
+        }
+        else if (info == 26 && reply.size() > 4) {
+            count = qFromBigEndian<quint32>(data + 1);
+            head = 5;
+        }
+        else
+            return reply;
+
+        appendCborHead(result, CBOR_MAP, count + 1);
+        result.append(QCborValue(QLatin1String("req_id")).toCbor());
+        result.append(cbor_.isEmpty() == false ? cbor_.value(QLatin1String("req_id")).toCbor()
+                                               : QCborValue::fromJsonValue(value("req_id")).toCbor());
+        result.append(reply.constData() + head, reply.size() - head);
+
+        return result;
+    }
+
+    if (reply.size() < 2 || reply.at(0) != '{')
+        return reply;
+
+    const Field *id = message_.isEmpty() == false ? field("req_id") : 0;
+
+    result.reserve(reply.size() + 32);
+    result.append("{\"req_id\":");
+
+    // from a JSON frame the id goes back exactly as the client wrote it
+    if (id)
+        result.append(message_.constData() + id->value, id->valueSize);
+    else {
+        QByteArray &buffer = encodeBuffers.localData();
+        JsonWriter writer(buffer);
+
+        writer.value(value("req_id").toVariant());
+        result.append(buffer);
+    }
+    if (reply.at(1) != '}')
+        result.append(',');
+    result.append(reply.constData() + 1, reply.size() - 1);
+
+    return result;
+}
@@ -0,0 +1,75 @@
+#ifndef REQUEST_H
+#define REQUEST_H
+
+#include <QJsonObject>
+#include <QCborMap>
+#include <QByteArray>
+#include <QVarLengthArray>
+
+class QWebSocket;
+class ConnectionShard;
+
+// One client command together with the connection it came from, the
+// socket, its serial number and the I/O shard owning it. The shard only
+// hands a reply to the socket if the serial still matches, a socket
+// created at the address of a closed one has another. The connection
+// picks its protocol at handshake, text JSON by default or binary CBOR,
+// and every reply is encoded in the same protocol. A command carrying
+// "req_id" gets it back in its reply, so replies to pipelined and
+// batched commands can come back in any order.
+//
+// A JSON frame is kept as its raw UTF-8 bytes. Construction only finds
+// where each top-level field lies, a field's value is decoded when a
+// handler asks for it, and the command name is matched as bytes.
+class Request
+{
+public:
+    enum Protocol {
+        Json,
+        Cbor
+    };
+
+    Request(ConnectionShard *shard, QWebSocket *socket, quint64 connectionId, Protocol protocol,
+            const QByteArray &message);
+    Request(ConnectionShard *shard, QWebSocket *socket, quint64 connectionId, Protocol protocol,
+            const QJsonObject &json);
+
+    bool isValid() const { return valid_; }
+    ConnectionShard *shard() const { return shard_; }
+    QWebSocket *socket() const { return socket_; }
+    quint64 connectionId() const { return connectionId_; }
+    Protocol protocol() const { return protocol_; }
+
+    QByteArray cmdName() const;
+    QString cmd() const;
+    bool contains(const QString &key) const;
+    QJsonValue value(const QString &key) const;
+
+    QByteArray encode(const QVariantMap &map) const;
+    QByteArray tag(const QByteArray &reply) const;
+    static QByteArray encode(const QVariantMap &map, Protocol protocol);
+
+private:
+    // where a top-level key and its value lie in message_
+    struct Field {
+        int key;
+        int keySize;
+        int value;
+        int valueSize;
+    };
+
+    ConnectionShard *shard_;
+    QWebSocket *socket_;
+    quint64 connectionId_;
+    Protocol protocol_;
+    bool valid_;
+    QByteArray message_;
+    QVarLengthArray<Field, 8> fields_;
+    QCborMap cbor_;
+    QJsonObject json_;
+
+    bool index();
+    const Field *field(const QString &key) const;
+};
+
+#endif // REQUEST_H
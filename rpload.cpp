@@ -0,0 +1,90 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QTimer>
+#include <QUrl>
+
+#include "loadclient.h"
+
+// default command mix, weighted like a shift: mostly occupancy polls
+#define DEFAULT_MIX     "table_busy=10,time=4,login=2,items=1,groups=1,tables=1,peoples=1"
+
+// Opens N simulated tablets against a running server, replays the
+// command mix for the given time and prints throughput and latency
+// percentiles. Run the server with --fixture to test without a database.
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    QCommandLineOption clientsOption("clients", "Simulated tablets.", "n", "100");
+    QCommandLineOption durationOption("duration", "Test length, s.", "s", "30");
+    QCommandLineOption rampOption("ramp", "Pause between opening two connections, ms.", "ms", "10");
+    QCommandLineOption thinkOption("think", "Pause between a reply and the next command, ms.", "ms", "0");
+    QCommandLineOption mixOption("mix", "Weighted command mix.", "mix", DEFAULT_MIX);
+    QCommandLineOption passwordOption("password", "Password sent with logins.", "password", "1001");
+    QCommandLineOption cborOption("cbor", "Talk binary CBOR instead of JSON.");
+    QTextStream out(stdout);
+    QList<LoadClient *> clients;
+    LoadMix mix;
+    LoadStats stats;
+    QElapsedTimer elapsed;
+    QTimer progress;
+    QString errText;
+    int ramp;
+
+    parser.addHelpOption();
+    parser.addPositionalArgument("url", "Server address, e.g. ws://127.0.0.1:8080");
+    parser.addOption(clientsOption);
+    parser.addOption(durationOption);
+    parser.addOption(rampOption);
+    parser.addOption(thinkOption);
+    parser.addOption(mixOption);
+    parser.addOption(passwordOption);
+    parser.addOption(cborOption);
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1)
+        parser.showHelp(1);
+
+    if (mix.parse(parser.value(mixOption), errText) == false) {
+        out << errText << endl;
+        return 1;
+    }
+
+    for (int x = 0; x < parser.value(clientsOption).toInt(); ++x)
+        clients << new LoadClient(QUrl(parser.positionalArguments().first()), parser.isSet(cborOption),
+                                  parser.value(passwordOption), parser.value(thinkOption).toInt(),
+                                  &mix, &stats, &app);
+
+    // connections opened one by one, like tablets waking up
+    ramp = parser.value(rampOption).toInt();
+    for (int x = 0; x < clients.size(); ++x)
+        QTimer::singleShot(x * ramp, clients[x], &LoadClient::start);
+
+    QObject::connect(&progress, &QTimer::timeout, [&]() {
+        int connected = 0;
+
+        foreach (LoadClient *client, clients)
+            connected += client->isConnected() ? 1 : 0;
+
+        out << QString("%1 s: %2 connected, %3 replies, %4 busy")
+               .arg(elapsed.elapsed() / 1000).arg(connected).arg(stats.replies()).arg(stats.busy()) << endl;
+    });
+
+    QTimer::singleShot(parser.value(durationOption).toInt() * 1000, [&]() {
+        double seconds = elapsed.elapsed() / 1000.0;
+
+        progress.stop();
+        foreach (LoadClient *client, clients)
+            client->stop();
+
+        out << stats.report(seconds) << flush;
+        app.quit();
+    });
+
+    elapsed.start();
+    progress.start(1000);
+
+    return app.exec();
+}
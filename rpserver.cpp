@@ -0,0 +1,930 @@
+#include <QWebSocket>
+#include <QJsonArray>
+#include <QUuid>
+
+#include "rpserver.h"
+#include "datamanagerbackend.h"
+#include "configuration.h"
+#include "api.h"
+#include "commandtask.h"
+#include "catalogcache.h"
+#include "catalogsnapshot.h"
+#include "dbeventlistener.h"
+#include "tablemonitor.h"
+#include "credentialindex.h"
+#include "profilerights.h"
+#include "serverstats.h"
+#include "metricsserver.h"
+#include "connectionshard.h"
+#include "orderwriter.h"
+#include "orderjournal.h"
+#include "orderreplayer.h"
+
+// rows of a page or stream fragment when the client gives no limit
+static const int DEFAULT_PAGE_ROWS = 500;
+
+// bounds of the client's limit for stream fragments
+static const int MIN_STREAM_ROWS = DEFAULT_PAGE_ROWS / 10;
+static const int MAX_STREAM_ROWS = DEFAULT_PAGE_ROWS * 4;
+
+// commands allowed to wait in the queue per worker thread
+static const int PENDING_COMMANDS_PER_THREAD = 16;
+
+// orders allowed to wait for the order writer
+static const int MAX_QUEUED_ORDERS = 1000;
+
+// a server serving the snapshot retries the database this often, ms
+static const int DATABASE_RETRY_INTERVAL = 5000;
+
+// the snapshot is written this long after the last catalog load, ms
+static const int SNAPSHOT_SAVE_DELAY = 2000;
+
+// log lines kept in memory and their length limit
+static const int LOG_RING_LINES = 2000;
+static const int LOG_LINE_LENGTH = 1024;
+
+RPServer::RPServer(QObject *parent) : QObject(parent),
+    compressThreshold_(0),
+    heartbeatInterval_(0),
+    idleTimeout_(0),
+    maxConnections_(0),
+    maxWriteQueue_(0),
+    tableMonitor_(0),
+    dbEvents_(0),
+    maxPendingCommands_(0)
+{
+    log_.reset(new ServerLog(LOG_RING_LINES, LOG_LINE_LENGTH));
+    stats_.reset(new ServerStats(pendingCommands_));
+    backend_.reset(new DataManagerBackendFactory());
+
+    qRegisterMetaType<QWebSocket *>("QWebSocket*");
+    qRegisterMetaType<qintptr>("qintptr");
+
+    funcMap_.insert(COMMAND::CMD_LOGIN,          &RPServer::cmdLogin);
+    funcMap_.insert(COMMAND::CMD_GET_PEOPLES,    &RPServer::cmdGetPeoples);
+    funcMap_.insert(COMMAND::CMD_ITEMS_GROUPS,   &RPServer::cmdGetItemsGroups);
+    funcMap_.insert(COMMAND::CMD_ITEMS,          &RPServer::cmdGetItems);
+    funcMap_.insert(COMMAND::CMD_GET_TABLES,     &RPServer::cmdGetTables);
+    funcMap_.insert(COMMAND::CMD_GET_TABLE_BUSY, &RPServer::cmdGetTableBusy);
+    funcMap_.insert(COMMAND::CMD_GET_TIME,       &RPServer::cmdGetTime);
+    funcMap_.insert(COMMAND::CMD_ADD_ORDER,      &RPServer::cmdAddOrder);
+    funcMap_.insert(COMMAND::CMD_ADD_ORDER_LINES, &RPServer::cmdAddOrderLines);
+    funcMap_.insert(COMMAND::CMD_SUBSCRIBE,      &RPServer::cmdSubscribe);
+    funcMap_.insert(COMMAND::CMD_BATCH,          &RPServer::cmdBatch);
+    funcMap_.insert(COMMAND::CMD_GET_STATS,      &RPServer::cmdGetStats);
+}
+
+RPServer::~RPServer()
+{
+    acceptor_.reset();
+    monitorThread_.quit();
+    monitorThread_.wait();
+    threadPool_.waitForDone();
+    // queued orders are written and answered before the shards go, the
+    // journal keeps what is not replayed yet
+    orderWriter_.reset();
+    orderReplayer_.reset();
+    // catalogs loaded during the save delay
+    if (snapshot_)
+        saveSnapshot();
+    // threaded shards are deleted as their thread finishes
+    foreach (QThread *thread, ioThreads_) {
+        thread->quit();
+        thread->wait();
+    }
+    if (ioThreads_.isEmpty() == true)
+        qDeleteAll(shards_);
+}
+
+// Replaces the Firebird backend, e.g. with a fixture for load tests.
+// Takes ownership, call before start().
+void RPServer::setBackend(DataBackendFactory *backend)
+{
+    backend_.reset(backend);
+}
+
+// Loads the configuration, connects to the database and starts
+// listening. Without a log file in the configuration a daemon logs to
+// stderr, where the service manager picks it up. When the catalog
+// snapshot has something to serve the server listens straight away and
+// connects on the monitor thread, the start only fails on the port.
+bool RPServer::start(bool logToConsole)
+{
+    QString logFile;
+    bool ok = false;
+
+    addLogInfo(trUtf8("Loading config..."));
+
+    configuration_.reset(new Configuration());
+    log_->setLevel(ServerLog::Level(configuration_->log_level));
+    logFile = configuration_->log_file;
+    if (logFile.isEmpty() == true && logToConsole == true)
+        logFile = LOG_CONSOLE;
+    if (log_->openFile(logFile, configuration_->log_max_size, configuration_->log_max_files) == true)
+        addLogInfo(trUtf8("Writing log to ") + logFile);
+
+    catalogCache_.reset(new CatalogCache());
+    credentialIndex_.reset(new CredentialIndex());
+    connect(catalogCache_.data(), &CatalogCache::invalidated, credentialIndex_.data(), &CredentialIndex::onCatalogInvalidated);
+    profileRights_.reset(new ProfileRightsCache());
+
+    dbEvents_ = new DbEventListener(configuration_->dbName, "SYSDBA", "masterkey");
+    dbEvents_->moveToThread(&monitorThread_);
+    connect(&monitorThread_, &QThread::finished, dbEvents_, &QObject::deleteLater);
+    connect(dbEvents_, &DbEventListener::eventPosted, catalogCache_.data(), &CatalogCache::onDbEvent);
+    connect(dbEvents_, &DbEventListener::eventPosted, profileRights_.data(), &ProfileRightsCache::onDbEvent);
+    connect(dbEvents_, &DbEventListener::connectionLost, dbEvents_, [this](const QString &errText) { onEventsLost(errText); });
+    connect(dbEvents_, &DbEventListener::resubscribed, dbEvents_, [this]() { onEventsResubscribed(); });
+
+    tableMonitor_ = new TableMonitor(backend_.data(), configuration_->dbName, configuration_->table_poll_interval);
+    tableMonitor_->moveToThread(&monitorThread_);
+    connect(&monitorThread_, &QThread::started, tableMonitor_, &TableMonitor::start);
+    connect(&monitorThread_, &QThread::finished, tableMonitor_, &QObject::deleteLater);
+    connect(tableMonitor_, &TableMonitor::logMessage, this, &RPServer::addLogInfo);
+    connect(dbEvents_, &DbEventListener::eventPosted, tableMonitor_, &TableMonitor::onDbEvent);
+
+    compressThreshold_ = configuration_->compress_threshold;
+
+    heartbeatInterval_ = configuration_->heartbeat_interval;
+    idleTimeout_ = configuration_->idle_timeout;
+    maxConnections_ = configuration_->max_connections;
+    maxWriteQueue_ = configuration_->max_write_queue;
+
+    threadPool_.setMaxThreadCount(configuration_->worker_threads);
+    threadPool_.setExpiryTimeout(-1);
+    maxPendingCommands_ = threadPool_.maxThreadCount() * PENDING_COMMANDS_PER_THREAD;
+
+    startOrders();
+
+    if (configuration_->metrics_port > 0) {
+        metrics_.reset(new MetricsServer(stats_.data()));
+        if (metrics_->start(configuration_->metrics_port) == true)
+            addLogInfo(QString(trUtf8("Serving metrics (http://localhost:%1/metrics)...").arg(configuration_->metrics_port)));
+        else {
+            addLogError(trUtf8("Error starting metrics endpoint..."));
+            metrics_.reset();
+        }
+    }
+
+    monitorThread_.start();
+
+    if (loadSnapshot() == true) {
+        if (listen() == false)
+            return false;
+
+        QMetaObject::invokeMethod(dbEvents_, [this]() { startDatabase(true); }, Qt::QueuedConnection);
+        return true;
+    }
+
+    QMetaObject::invokeMethod(dbEvents_, [this, &ok]() { ok = startDatabase(false); }, Qt::BlockingQueuedConnection);
+    if (ok == false)
+        return false;
+
+    return listen();
+}
+
+// Checks the database and subscribes to the catalog events, on the
+// monitor thread. Serving a snapshot it keeps trying until the database
+// is up, then checks the snapshot against it.
+bool RPServer::startDatabase(bool retry)
+{
+    QScopedPointer<DataBackend> manager(backend_->create());
+    QString errText;
+
+    if (manager->connect(configuration_->dbName, "SYSDBA", "masterkey", errText) == true)
+        addLogInfo(trUtf8("Connecting to database... ") + configuration_->dbName );
+    else {
+        addLogError(trUtf8("Error connecting to database... ") + configuration_->dbName);
+        addLogError(errText);
+        if (retry == true)
+            QTimer::singleShot(DATABASE_RETRY_INTERVAL, dbEvents_, [this]() { startDatabase(true); });
+        return false;
+    }
+
+    // the fixture has nothing to post events, its catalogs are cached as
+    // they are and its occupancy is polled
+    if (backend_->fixedCatalogs() == true)
+        addLogInfo(trUtf8("Fixed catalogs, cache enabled without database events..."));
+    else if (dbEvents_->start(CatalogCache::eventNames() << TableMonitor::eventName() << ProfileRightsCache::eventName(),
+                              CatalogCache::generatorName(),
+                              configuration_->catalog_poll_interval, errText) == false) {
+        addLogError(trUtf8("Error subscribing to catalog events, cache disabled..."));
+        addLogError(errText);
+        disableCaches();
+        return true;
+    }
+    else {
+        // polling the generation says nothing about the tables, the
+        // monitor's state is only current while occupancy events arrive
+        tableEvents_.storeRelease(dbEvents_->notifying() == true ? 1 : 0);
+    }
+
+    // served from the snapshot until now, with nothing to invalidate the
+    // logins and rights cached meanwhile
+    if (cacheEnabled_.fetchAndStoreOrdered(1) == 1) {
+        QStringList cmds = snapshotCatalogs_;
+
+        credentialIndex_->clear();
+        profileRights_->clear();
+        threadPool_.start([this, cmds]() { validateSnapshot(cmds); });
+    }
+
+    return true;
+}
+
+// Nothing keeps the caches fresh without the events, the commands read
+// the database until they are back.
+void RPServer::disableCaches()
+{
+    cacheEnabled_.storeRelease(0);
+    tableEvents_.storeRelease(0);
+    credentialIndex_->clear();
+    profileRights_->clear();
+}
+
+// The events connection failed its probe, on the monitor thread.
+void RPServer::onEventsLost(const QString &errText)
+{
+    addLogError(trUtf8("Lost the catalog events connection, cache disabled..."));
+    addLogError(errText);
+    disableCaches();
+}
+
+// Events posted while the connection was down are gone, everything
+// cached before is dropped.
+void RPServer::onEventsResubscribed()
+{
+    addLogInfo(trUtf8("Catalog events subscribed again, cache enabled..."));
+    catalogCache_->invalidateAll();
+    credentialIndex_->clear();
+    profileRights_->clear();
+    tableEvents_.storeRelease(dbEvents_->notifying() == true ? 1 : 0);
+    cacheEnabled_.storeRelease(1);
+}
+
+// Serves the catalogs of the snapshot file, if one is configured and
+// holds any, true when there is something to serve.
+bool RPServer::loadSnapshot()
+{
+    QList<CatalogSnapshot::Catalog> catalogs;
+    QString errText;
+
+    if (configuration_->snapshot_file.isEmpty() == true)
+        return false;
+
+    snapshot_.reset(new CatalogSnapshot(configuration_->snapshot_file, configuration_->dbName));
+    snapshotTimer_.setSingleShot(true);
+    snapshotTimer_.setInterval(SNAPSHOT_SAVE_DELAY);
+    connect(&snapshotTimer_, &QTimer::timeout, this, &RPServer::saveSnapshot);
+
+    if (snapshot_->load(catalogs, errText) == false) {
+        addLogError(trUtf8("Error reading catalog snapshot... ") + snapshot_->fileName());
+        addLogError(errText);
+        return false;
+    }
+
+    if (catalogs.isEmpty() == true)
+        return false;
+
+    foreach (const CatalogSnapshot::Catalog &catalog, catalogs) {
+        catalogCache_->restore(catalog.cmd, catalog.body.value(catalog.key).toList(), catalog.body, catalog.responses);
+        snapshotCatalogs_ << catalog.cmd;
+    }
+    cacheEnabled_.storeRelease(1);
+
+    addLogInfo(QString(trUtf8("Serving %1 catalogs from snapshot...").arg(catalogs.size())));
+
+    return true;
+}
+
+// Reads the snapshot's catalogs from the database once it is up. A
+// catalog changed while the server was down is dropped from the cache
+// and loaded again on the next request.
+void RPServer::validateSnapshot(const QStringList &cmds)
+{
+    foreach (const QString &cmd, cmds) {
+        QVariantMap body;
+        QVariantList rows;
+        quint64 generation;
+        quint64 version;
+
+        // already dropped by a catalog event
+        if (catalogCache_->findBody(cmd, body, generation) == false)
+            continue;
+
+        // an empty catalog is taken for a failed read, the snapshot stays
+        rows = fetchCatalog(cmd);
+        if (rows.isEmpty() == true)
+            continue;
+
+        version = catalogCache_->updateRows(cmd, generation, rows);
+        if (version != 0 && version != body.value("version").toULongLong()) {
+            addLogInfo(cmd + trUtf8(" changed since the snapshot, reloading..."));
+            catalogCache_->invalidate(cmd);
+        }
+    }
+
+    addLogInfo(trUtf8("Catalog snapshot checked against the database"));
+}
+
+// Runs on the main thread a while after the last catalog load, so a
+// burst of reloads is written once.
+void RPServer::saveSnapshot()
+{
+    QString errText;
+
+    if (snapshot_->save(errText) == false) {
+        addLogError(trUtf8("Error writing catalog snapshot... ") + snapshot_->fileName());
+        addLogError(errText);
+    }
+}
+
+bool RPServer::listen()
+{
+    addLogInfo(QString(trUtf8("Starting workers (%1 threads)...").arg(threadPool_.maxThreadCount())));
+
+    startShards(configuration_->io_threads);
+
+    acceptor_.reset(new ConnectionAcceptor(shards_));
+    if (acceptor_->listen(QHostAddress::Any, configuration_->ws_port) == false) {
+        addLogError(trUtf8("Error starting server..."));
+        return false;
+    }
+
+    addLogInfo(QString(trUtf8("Starting server (port %1)...").arg(configuration_->ws_port)));
+
+    return true;
+}
+
+// Orders go straight to the database, or through the journal when one
+// is configured and opens.
+void RPServer::startOrders()
+{
+    QString errText;
+
+    if (configuration_->journal_file.isEmpty() == false) {
+        orderJournal_.reset(new OrderJournal(configuration_->journal_file));
+        if (orderJournal_->open(errText) == true)
+            addLogInfo(trUtf8("Journaling orders to ") + orderJournal_->fileName());
+        else {
+            addLogError(trUtf8("Error opening order journal, writing orders directly... ") + orderJournal_->fileName());
+            addLogError(errText);
+            orderJournal_.reset();
+        }
+    }
+
+    orderWriter_.reset(new OrderWriter(this, backend_.data(), configuration_->dbName, orderJournal_.data(),
+                                       configuration_->order_batch_window, configuration_->order_batch_size,
+                                       MAX_QUEUED_ORDERS));
+    orderWriter_->start();
+
+    if (orderJournal_) {
+        orderReplayer_.reset(new OrderReplayer(orderJournal_.data(), backend_.data(), configuration_->dbName,
+                                               configuration_->order_batch_size, log_.data()));
+        orderReplayer_->start();
+    }
+}
+
+// Every I/O thread runs one shard on its own event loop, sharing the
+// caches and the worker pool. Without I/O threads a single shard runs on
+// the main thread.
+void RPServer::startShards(int ioThreads)
+{
+    for (int x = 0; x < qMax(ioThreads, 1); ++x) {
+        ConnectionShard *shard = new ConnectionShard(this, x);
+
+        connect(tableMonitor_, &TableMonitor::tablesChanged, shard, &ConnectionShard::publishTables);
+
+        if (ioThreads > 0) {
+            QThread *thread = new QThread(this);
+
+            shard->moveToThread(thread);
+            connect(thread, &QThread::started, shard, &ConnectionShard::start);
+            connect(thread, &QThread::finished, shard, &QObject::deleteLater);
+            thread->start();
+            ioThreads_ << thread;
+        }
+        else
+            shard->start();
+
+        shards_ << shard;
+    }
+
+    if (ioThreads > 0)
+        addLogInfo(QString(trUtf8("Starting I/O (%1 threads)...").arg(ioThreads)));
+}
+
+void RPServer::addLogInfo(const QString &text)
+{
+    log_->write(ServerLog::Info, text);
+}
+
+void RPServer::addLogDebug(const QString &text)
+{
+    log_->write(ServerLog::Debug, text);
+}
+
+void RPServer::addLogError(const QString &text)
+{
+    log_->write(ServerLog::Error, text);
+}
+
+bool RPServer::reserveConnection()
+{
+    if (maxConnections_ > 0 && connectionCount_.fetchAndAddOrdered(1) >= maxConnections_) {
+        connectionCount_.deref();
+        return false;
+    }
+
+    return true;
+}
+
+void RPServer::releaseConnection()
+{
+    if (maxConnections_ > 0)
+        connectionCount_.deref();
+}
+
+bool RPServer::reserveCommand()
+{
+    if (pendingCommands_.fetchAndAddOrdered(1) >= maxPendingCommands_) {
+        pendingCommands_.deref();
+        return false;
+    }
+
+    return true;
+}
+
+QVariantMap RPServer::errorReply(const QString &res)
+{
+    QVariantMap pMap;
+
+    pMap["err"] = 1;
+    pMap["res"] = res;
+
+    return pMap;
+}
+
+void RPServer::runCommand(const Request &request)
+{
+    QByteArray result = execCommand(request);
+
+    pendingCommands_.deref();
+    // the reply was already sent from the socket's thread
+    if (result.isEmpty() == true)
+        return;
+
+    postResponse(request, result);
+}
+
+void RPServer::postResponse(const Request &request, const QByteArray &result)
+{
+    QMetaObject::invokeMethod(request.shard(), "sendResponse", Qt::QueuedConnection,
+                              Q_ARG(QWebSocket *, request.socket()), Q_ARG(quint64, request.connectionId()),
+                              Q_ARG(QByteArray, request.tag(result)));
+}
+
+QByteArray RPServer::execCommand(const Request &request)
+{
+    if (request.isValid() == true) {
+        const MapFunction::Entry *command = funcMap_.find(request.cmdName());
+        if (command) {
+            QElapsedTimer timer;
+            QByteArray result;
+
+            ServerStats::beginCommand();
+            timer.start();
+            result = (this->*(command->handler))(request);
+            stats_->endCommand(command->text, timer.nsecsElapsed());
+
+            return result;
+        }
+    }
+
+    return request.encode(errorReply("unkwnow_cmd"));
+}
+
+// The backend of the calling worker thread, each worker has its own
+// connection so handlers never wait on each other for the database. A
+// worker that lost its connection reconnects here. 0 while the worker
+// has never been connected, the next command tries again.
+DataBackend *RPServer::dataManager()
+{
+    QString errText;
+
+    if (workerDataManagers_.hasLocalData() == false) {
+        DataBackend *manager = backend_->create();
+
+        if (manager->connect(configuration_->dbName, "SYSDBA", "masterkey", errText) == false) {
+            addLogError(trUtf8("Error connecting worker to database... ") + errText);
+            delete manager;
+            return 0;
+        }
+        workerDataManagers_.setLocalData(manager);
+    }
+    else if (workerDataManagers_.localData()->check(errText) == false && errText.isEmpty() == false)
+        addLogError(trUtf8("Error reconnecting worker to database... ") + errText);
+
+    return workerDataManagers_.localData();
+}
+
+QVariantList RPServer::fetchCatalog(const QString &cmd)
+{
+    ServerStats::Span span(ServerStats::Db);
+    DataBackend *backend = dataManager();
+
+    if (!backend)
+        return QVariantList();
+
+    if (cmd == COMMAND::CMD_ITEMS)
+        return backend->getItems();
+    if (cmd == COMMAND::CMD_ITEMS_GROUPS)
+        return backend->getItemsGroups();
+    if (cmd == COMMAND::CMD_GET_PEOPLES)
+        return backend->getPeoples();
+    if (cmd == COMMAND::CMD_GET_TABLES)
+        return backend->getTables();
+
+    return QVariantList();
+}
+
+// Catalog reply body with its version, from the cache or loaded into it.
+// A failed read has no version and is not cached.
+QVariantMap RPServer::catalogBody(const QString &cmd, const QString &res, const QString &key, quint64 &generation)
+{
+    QVariantMap body;
+
+    // the other protocol may have filled the cache already
+    if (catalogCache_->findBody(cmd, body, generation) == false) {
+        QVariantList rows;
+
+        generation = catalogCache_->generation(cmd);
+        rows = fetchCatalog(cmd);
+
+        body["err"] = ERROR::API_ERROR_NONE;
+        body["res"] = res;
+        body[key] = rows;
+
+        // an empty catalog is a failed read, it goes out without a version
+        // and neither the change log nor the cache hear of it
+        if (rows.isEmpty() == true)
+            return body;
+
+        body["version"] = catalogCache_->updateRows(cmd, generation, rows);
+        if (catalogCache_->insert(cmd, generation, body) == true && snapshot_) {
+            snapshot_->update(cmd, key, body);
+            QMetaObject::invokeMethod(&snapshotTimer_, "start", Qt::QueuedConnection);
+        }
+    }
+
+    return body;
+}
+
+// Full catalog from the cache, or only the rows changed after the
+// client's "since_version" when the change log still covers it. Paged
+// and streamed requests always get the full catalog, see catalogPage.
+QByteArray RPServer::catalogCommand(const QString &cmd, const QString &res, const QString &key, const Request &request)
+{
+    QVariantMap pMap;
+    QByteArray result;
+    quint64 generation;
+    bool paged = request.contains("limit") || request.contains("cursor") || request.value("stream").toBool();
+
+    pMap["err"] = ERROR::API_ERROR_NONE;
+    pMap["res"] = res;
+
+    if (cacheEnabled_.loadAcquire() == 0) {
+        QVariantList rows = fetchCatalog(cmd);
+
+        if (paged == true)
+            return catalogPage(res, key, 0, rows, request);
+
+        pMap[key] = rows;
+        return request.encode(pMap);
+    }
+
+    if (paged == true) {
+        QVariantMap body = catalogBody(cmd, res, key, generation);
+
+        return catalogPage(res, key, body.value("version").toULongLong(), body.value(key).toList(), request);
+    }
+
+    if (catalogCache_->find(cmd, request.protocol(), result) == false) {
+        QVariantMap body = catalogBody(cmd, res, key, generation);
+
+        result = request.encode(body);
+        if (body.contains("version") == true)
+            catalogCache_->insert(cmd, generation, request.protocol(), result);
+    }
+
+    if (request.contains("since_version") == true) {
+        QVariantList changed;
+        QVariantList deleted;
+        quint64 version;
+        quint64 since = request.value("since_version").toVariant().toULongLong();
+
+        if (catalogCache_->findChanges(cmd, since, version, changed, deleted) == true) {
+            pMap["version"] = version;
+            pMap["since_version"] = since;
+            pMap[key] = changed;
+            pMap["deleted"] = deleted;
+
+            return request.encode(pMap);
+        }
+    }
+
+    return result;
+}
+
+// One page of "limit" rows starting at the client's "cursor", with the
+// cursor of the next page while rows remain. The cursor holds the catalog
+// version, a page asked for after the catalog changed gets
+// "cursor_expired" and the client starts over. With "stream" every page
+// goes out as its own reply with "more" set, the reply without "more"
+// is the terminator and carries the row count.
+QByteArray RPServer::catalogPage(const QString &res, const QString &key, quint64 version,
+                                 const QVariantList &rows, const Request &request)
+{
+    QVariantMap pMap;
+    int limit = request.value("limit").toInt();
+    int offset = 0;
+
+    if (limit <= 0)
+        limit = DEFAULT_PAGE_ROWS;
+
+    // tiny pages would flood the socket past its write queue limit
+    if (request.value("stream").toBool() == true)
+        limit = qBound(MIN_STREAM_ROWS, limit, MAX_STREAM_ROWS);
+
+    if (request.contains("cursor") == true) {
+        QStringList cursor = request.value("cursor").toString().split('.');
+
+        if (cursor.size() != 2 || cursor[0].toULongLong() != version)
+            return request.encode(errorReply("cursor_expired"));
+        offset = qBound(0, cursor[1].toInt(), rows.size());
+    }
+
+    pMap["err"] = ERROR::API_ERROR_NONE;
+    pMap["res"] = res;
+    pMap["version"] = version;
+
+    if (request.value("stream").toBool() == true) {
+        int part = 0;
+
+        for (; offset < rows.size(); offset += limit) {
+            QVariantMap fragment = pMap;
+
+            fragment[key] = rows.mid(offset, limit);
+            fragment["part"] = part++;
+            fragment["more"] = true;
+            postResponse(request, request.encode(fragment));
+        }
+
+        pMap["part"] = part;
+        pMap["more"] = false;
+        pMap["count"] = rows.size();
+
+        return request.encode(pMap);
+    }
+
+    pMap[key] = rows.mid(offset, limit);
+    pMap["total"] = rows.size();
+    if (offset + limit < rows.size())
+        pMap["cursor"] = QString("%1.%2").arg(version).arg(offset + limit);
+
+    return request.encode(pMap);
+}
+
+// The profile's rights compiled to bitsets, see ProfileRights, from the
+// cache or read and compiled once. Empty when the profile can't be read.
+QVariantMap RPServer::profileRights(const QVariant &profileId)
+{
+    QVariantMap rights;
+    QVariantMap profile;
+    bool cached = cacheEnabled_.loadAcquire() == 1;
+    quint64 generation = profileRights_->generation();
+
+    if (cached == true && profileRights_->find(profileId.toString(), rights) == true)
+        return rights;
+
+    {
+        ServerStats::Span span(ServerStats::Db);
+        DataBackend *backend = dataManager();
+
+        if (backend)
+            profile = backend->getProfile(profileId);
+    }
+
+    if (profile.isEmpty() == true)
+        return rights;
+
+    rights = ProfileRights::compile(profile).toMap();
+    if (cached == true)
+        profileRights_->insert(profileId.toString(), generation, rights);
+
+    return rights;
+}
+
+QByteArray RPServer::cmdLogin(const Request &request)
+{
+    QVariantMap pMap;
+    QString people_password = request.value("people_password").toString();
+
+    if (cacheEnabled_.loadAcquire() == 1) {
+        QByteArray key = credentialIndex_->key(people_password);
+
+        if (credentialIndex_->find(key, pMap) == false) {
+            quint64 generation = credentialIndex_->generation();
+            ServerStats::Span span(ServerStats::Db);
+            DataBackend *backend = dataManager();
+
+            if (backend)
+                pMap = backend->getPeople(people_password);
+            if (pMap.size() > 0)
+                credentialIndex_->insert(key, generation, pMap);
+        }
+    }
+    else {
+        ServerStats::Span span(ServerStats::Db);
+        DataBackend *backend = dataManager();
+
+        if (backend)
+            pMap = backend->getPeople(people_password);
+    }
+
+    if (pMap.contains("profile_id") == true) {
+        QVariantMap rights = profileRights(pMap.value("profile_id"));
+
+        if (rights.isEmpty() == false)
+            pMap["rights"] = rights;
+    }
+
+    pMap["err"] = pMap.size() > 0 ? ERROR::API_ERROR_NONE : ERROR::API_ERROR_LOGIN;
+    pMap["res"] = COMMAND::CMD_LOGIN;
+
+    return request.encode(pMap);
+}
+
+QByteArray RPServer::cmdGetPeoples(const Request &request)
+{
+    return catalogCommand(COMMAND::CMD_GET_PEOPLES, COMMAND::CMD_GET_PEOPLES, "peoples", request);
+}
+
+QByteArray RPServer::cmdGetItemsGroups(const Request &request)
+{
+    return catalogCommand(COMMAND::CMD_ITEMS_GROUPS, COMMAND::CMD_GET_PEOPLES, "groups", request);
+}
+
+QByteArray RPServer::cmdGetItems(const Request &request)
+{
+    return catalogCommand(COMMAND::CMD_ITEMS, COMMAND::CMD_GET_PEOPLES, "items", request);
+}
+
+QByteArray RPServer::cmdGetTables(const Request &request)
+{
+    return catalogCommand(COMMAND::CMD_GET_TABLES, COMMAND::CMD_GET_TABLES, "tables", request);
+}
+
+QByteArray RPServer::cmdGetTableBusy(const Request &request)
+{
+    QVariantMap pMap;
+    QVariantList tables;
+
+    pMap["err"] = ERROR::API_ERROR_NONE;
+    pMap["res"] = COMMAND::CMD_GET_TABLE_BUSY;
+    // without events the monitor may be a whole poll interval behind
+    if (tableEvents_.loadAcquire() == 1 && tableMonitor_->tables(tables) == true)
+        pMap["tables"] = tables;
+    else {
+        ServerStats::Span span(ServerStats::Db);
+        DataBackend *backend = dataManager();
+
+        pMap["tables"] = backend ? backend->getTableBusy() : QVariantList();
+    }
+
+    return request.encode(pMap);
+}
+
+QByteArray RPServer::cmdGetTime(const Request &request)
+{
+    QVariantMap pMap;
+
+    pMap["err"] = ERROR::API_ERROR_NONE;
+    pMap["res"] = COMMAND::CMD_GET_TIME;
+    pMap["time"] = QDateTime::currentDateTime().toString(FORMAT::DATETIME_FORMAT);
+
+    return request.encode(pMap);
+}
+
+// Checks the lines and queues the order for the writer, the reply comes
+// from the writer once the order is in the journal or the database. A
+// tablet retrying a write sends the same "write_key", it is written once.
+QByteArray RPServer::submitOrder(const Request &request, QVariantMap &order)
+{
+    QVariantList lines;
+    QString writeKey = request.value("write_key").toString();
+
+    foreach (const QVariant &value, request.value("lines").toArray().toVariantList()) {
+        QVariantMap item = value.toMap();
+        QVariantMap line;
+
+        if (item.value("item_id").toLongLong() <= 0 || item.value("quantity").toDouble() <= 0)
+            return request.encode(errorReply("bad_order"));
+
+        line["item_id"] = item.value("item_id").toLongLong();
+        line["quantity"] = item.value("quantity").toDouble();
+        line["price"] = item.value("price").toDouble();
+        line["comment"] = item.value("comment").toString();
+        lines << line;
+    }
+
+    if (lines.isEmpty() == true)
+        return request.encode(errorReply("bad_order"));
+    order["lines"] = lines;
+    order["write_key"] = writeKey.isEmpty() == false ? writeKey : QUuid::createUuid().toString(QUuid::WithoutBraces);
+    if (order.contains("table_id") == true && order.contains("order_key") == false)
+        order["order_key"] = order.value("write_key");
+
+    if (orderWriter_->submit(request, order) == false)
+        return request.encode(errorReply("server_busy"));
+
+    return QByteArray();
+}
+
+QByteArray RPServer::cmdAddOrder(const Request &request)
+{
+    QVariantMap order;
+
+    if (request.value("table_id").toInt() <= 0 || request.value("people_id").toInt() <= 0)
+        return request.encode(errorReply("bad_order"));
+
+    order["table_id"] = request.value("table_id").toInt();
+    order["people_id"] = request.value("people_id").toInt();
+    order["guests"] = qMax(request.value("guests").toInt(), 1);
+    if (request.value("order_key").toString().isEmpty() == false)
+        order["order_key"] = request.value("order_key").toString();
+
+    return submitOrder(request, order);
+}
+
+QByteArray RPServer::cmdAddOrderLines(const Request &request)
+{
+    QVariantMap order;
+
+    // a journaled order has no id yet, its key stands in for it
+    if (request.value("order_id").toVariant().toLongLong() > 0)
+        order["order_id"] = request.value("order_id").toVariant().toLongLong();
+    else if (request.value("order_key").toString().isEmpty() == false)
+        order["order_key"] = request.value("order_key").toString();
+    else
+        return request.encode(errorReply("bad_order"));
+
+    return submitOrder(request, order);
+}
+
+QByteArray RPServer::cmdSubscribe(const Request &request)
+{
+    QStringList topics;
+
+    foreach (const QVariant &topic, request.value("topics").toArray().toVariantList()) {
+        if (topic.toString() == TOPIC_TABLES)
+            topics << topic.toString();
+    }
+
+    QMetaObject::invokeMethod(request.shard(), "setTopics", Qt::QueuedConnection,
+                              Q_ARG(QWebSocket *, request.socket()), Q_ARG(quint64, request.connectionId()),
+                              Q_ARG(QStringList, topics),
+                              Q_ARG(QJsonValue, request.value("req_id")));
+
+    return QByteArray();
+}
+
+// Every command of "cmds" runs as its own task, each reply goes back as
+// soon as it is ready, tagged with the command's "req_id".
+QByteArray RPServer::cmdBatch(const Request &request)
+{
+    foreach (const QJsonValue &value, request.value("cmds").toArray()) {
+        Request command(request.shard(), request.socket(), request.connectionId(), request.protocol(),
+                        value.toObject());
+
+        if (command.cmd() == COMMAND::CMD_BATCH)
+            postResponse(command, command.encode(errorReply("unkwnow_cmd")));
+        else if (reserveCommand() == false)
+            postResponse(command, command.encode(errorReply("server_busy")));
+        else
+            threadPool_.start(new CommandTask(this, request.shard(), request.socket(), request.connectionId(),
+                                              request.protocol(), value.toObject()));
+    }
+
+    return QByteArray();
+}
+
+QByteArray RPServer::cmdGetStats(const Request &request)
+{
+    QVariantMap pMap = stats_->toMap();
+
+    pMap["err"] = ERROR::API_ERROR_NONE;
+    pMap["res"] = COMMAND::CMD_GET_STATS;
+
+    return request.encode(pMap);
+}
@@ -0,0 +1,157 @@
+#ifndef RPSERVER_H
+#define RPSERVER_H
+
+#include <QObject>
+#include <QScopedPointer>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QAtomicInt>
+#include <QThread>
+#include <QTimer>
+#include <QStringList>
+
+#include "request.h"
+#include "serverlog.h"
+#include "commandtable.h"
+
+class QWebSocket;
+class DataBackend;
+class DataBackendFactory;
+class Configuration;
+class CatalogCache;
+class CatalogSnapshot;
+class DbEventListener;
+class TableMonitor;
+class CredentialIndex;
+class ProfileRightsCache;
+class ServerStats;
+class MetricsServer;
+class ConnectionShard;
+class ConnectionAcceptor;
+class OrderWriter;
+class OrderJournal;
+class OrderReplayer;
+
+// The tablet server without any widgets: command dispatch, caches and
+// the database, shared by the I/O shards holding the connections. Runs
+// the same under the monitor window and as a headless daemon. With a
+// catalog snapshot on disk it starts listening first and reaches the
+// database in the background.
+class RPServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RPServer(QObject *parent = 0);
+    ~RPServer();
+
+    void setBackend(DataBackendFactory *backend);
+    bool start(bool logToConsole = false);
+    ServerLog *log() const { return log_.data(); }
+
+private Q_SLOTS:
+    void addLogInfo(const QString &text);
+
+private:
+    friend class CommandTask;
+    friend class ConnectionShard;
+    friend class OrderWriter;
+
+    typedef QByteArray (RPServer::*cmdFunction)(const Request &);
+    typedef CommandTable<cmdFunction> MapFunction;
+
+    QScopedPointer<ServerLog> log_;
+    QScopedPointer<DataBackendFactory> backend_;
+    QScopedPointer<Configuration> configuration_;
+    QScopedPointer<CatalogCache> catalogCache_;
+    QScopedPointer<CredentialIndex> credentialIndex_;
+    QScopedPointer<ProfileRightsCache> profileRights_;
+    QScopedPointer<CatalogSnapshot> snapshot_;
+    QStringList snapshotCatalogs_;
+    QTimer snapshotTimer_;
+    // the caches are used only while the catalog events keep them fresh
+    QAtomicInt cacheEnabled_;
+    // the monitor's occupancy is served only while table events arrive
+    QAtomicInt tableEvents_;
+    QScopedPointer<ServerStats> stats_;
+    QScopedPointer<MetricsServer> metrics_;
+
+    MapFunction funcMap_;
+
+    QScopedPointer<ConnectionAcceptor> acceptor_;
+    QList<ConnectionShard *> shards_;
+    QList<QThread *> ioThreads_;
+    QAtomicInt connectionCount_;
+
+    // read by the shards, set once in start()
+    int compressThreshold_;
+    int heartbeatInterval_;
+    int idleTimeout_;
+    int maxConnections_;
+    qint64 maxWriteQueue_;
+
+    // the table monitor and the catalog events, on their own connections
+    QThread monitorThread_;
+    TableMonitor *tableMonitor_;
+    DbEventListener *dbEvents_;
+
+    QScopedPointer<OrderJournal> orderJournal_;
+    QScopedPointer<OrderWriter> orderWriter_;
+    QScopedPointer<OrderReplayer> orderReplayer_;
+
+    QThreadStorage<DataBackend *> workerDataManagers_;
+    QAtomicInt pendingCommands_;
+    int maxPendingCommands_;
+    QThreadPool threadPool_;
+
+    DataBackend *dataManager();
+    void addLogDebug(const QString &text);
+    void addLogError(const QString &text);
+
+    bool startDatabase(bool retry);
+    void disableCaches();
+    void onEventsLost(const QString &errText);
+    void onEventsResubscribed();
+    bool loadSnapshot();
+    void validateSnapshot(const QStringList &cmds);
+    void saveSnapshot();
+    bool listen();
+    void startShards(int ioThreads);
+    bool reserveConnection();
+    void releaseConnection();
+
+    QByteArray execCommand(const Request &request);
+    void runCommand(const Request &request);
+    void postResponse(const Request &request, const QByteArray &result);
+    bool reserveCommand();
+    static QVariantMap errorReply(const QString &res);
+
+    QVariantList fetchCatalog(const QString &cmd);
+    QVariantMap catalogBody(const QString &cmd, const QString &res, const QString &key, quint64 &generation);
+    QByteArray catalogCommand(const QString &cmd, const QString &res, const QString &key, const Request &request);
+    QByteArray catalogPage(const QString &res, const QString &key, quint64 version,
+                           const QVariantList &rows, const Request &request);
+
+    QVariantMap profileRights(const QVariant &profileId);
+
+    QByteArray cmdLogin(const Request &request);
+    QByteArray cmdGetPeoples(const Request &request);
+    QByteArray cmdGetItemsGroups(const Request &request);
+    QByteArray cmdGetItems(const Request &request);
+
+    QByteArray cmdGetTables(const Request &request);
+    QByteArray cmdGetTableBusy(const Request &request);
+
+    QByteArray cmdGetTime(const Request &request);
+
+    void startOrders();
+    QByteArray submitOrder(const Request &request, QVariantMap &order);
+    QByteArray cmdAddOrder(const Request &request);
+    QByteArray cmdAddOrderLines(const Request &request);
+
+    QByteArray cmdSubscribe(const Request &request);
+    QByteArray cmdBatch(const Request &request);
+    QByteArray cmdGetStats(const Request &request);
+};
+
+#endif // RPSERVER_H
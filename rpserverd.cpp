@@ -0,0 +1,77 @@
+#include <QCoreApplication>
+#include <QSocketNotifier>
+#include <QCommandLineParser>
+
+#include <sys/socket.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cstring>
+
+#include "rpserver.h"
+#include "fixturebackend.h"
+
+// size of the --fixture catalogs
+static const int FIXTURE_PEOPLES = 50;
+static const int FIXTURE_GROUPS = 40;
+static const int FIXTURE_ITEMS = 1500;
+static const int FIXTURE_TABLES = 60;
+
+// SIGTERM and SIGINT only write a byte here, the event loop reads it and
+// quits, so the server shuts down outside the signal handler
+static int signalSockets[2];
+
+static void onStopSignal(int)
+{
+    char signal = 1;
+
+    ssize_t written = ::write(signalSockets[0], &signal, sizeof(signal));
+    Q_UNUSED(written);
+}
+
+static bool installStopSignals()
+{
+    struct sigaction action;
+
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, signalSockets) != 0)
+        return false;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = onStopSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+
+    return sigaction(SIGTERM, &action, 0) == 0 && sigaction(SIGINT, &action, 0) == 0;
+}
+
+// Headless server, no widgets: runs under a service manager and logs to
+// stderr unless the configuration names a log file. With --fixture it
+// serves generated catalogs from memory, for load tests without a
+// database.
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    QCommandLineOption fixture("fixture", "Serve in-memory fixture data instead of the database.");
+    QCommandLineOption fixtureDelay("fixture-delay", "Delay added to every fixture call, ms.", "ms", "0");
+    RPServer server;
+
+    parser.addHelpOption();
+    parser.addOption(fixture);
+    parser.addOption(fixtureDelay);
+    parser.process(app);
+
+    if (parser.isSet(fixture) == true)
+        server.setBackend(new FixtureBackendFactory(FIXTURE_PEOPLES, FIXTURE_GROUPS, FIXTURE_ITEMS, FIXTURE_TABLES,
+                                                    parser.value(fixtureDelay).toInt()));
+
+    if (installStopSignals() == true) {
+        QSocketNotifier *notifier = new QSocketNotifier(signalSockets[1], QSocketNotifier::Read, &app);
+
+        QObject::connect(notifier, &QSocketNotifier::activated, &app, &QCoreApplication::quit);
+    }
+
+    if (server.start(true) == false)
+        return 1;
+
+    return app.exec();
+}
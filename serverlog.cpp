@@ -0,0 +1,168 @@
+#include <QDateTime>
+#include <cstdio>
+
+#include "serverlog.h"
+
+static const char *LEVEL_NAMES[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+
+// lines waiting for the file at most, more are dropped
+static const int MAX_PENDING_LINES = 10000;
+
+ServerLog::ServerLog(int capacity, int maxLineLength, QObject *parent) : QObject(parent),
+    ring_(capacity),
+    count_(0),
+    maxLineLength_(maxLineLength),
+    level_(ServerLog::Debug),
+    writer_(0)
+{
+}
+
+ServerLog::~ServerLog()
+{
+    if (writer_) {
+        QMetaObject::invokeMethod(writer_, "flush", Qt::BlockingQueuedConnection);
+        writerThread_.quit();
+        writerThread_.wait();
+    }
+}
+
+void ServerLog::setLevel(Level level)
+{
+    QMutexLocker locker(&mutex_);
+
+    level_ = level;
+}
+
+bool ServerLog::openFile(const QString &fileName, qint64 maxSize, int maxFiles)
+{
+    if (writer_ || fileName.isEmpty() == true)
+        return false;
+
+    writer_ = new LogFileWriter(fileName, maxSize, maxFiles);
+    writer_->moveToThread(&writerThread_);
+    connect(&writerThread_, &QThread::started, writer_, &LogFileWriter::open);
+    connect(&writerThread_, &QThread::finished, writer_, &QObject::deleteLater);
+    writerThread_.start(QThread::LowPriority);
+
+    return true;
+}
+
+void ServerLog::write(Level level, const QString &text)
+{
+    QString line;
+
+    {
+        QMutexLocker locker(&mutex_);
+
+        if (level < level_)
+            return;
+    }
+
+    line = QDateTime::currentDateTime().toString("hh:mm:ss.zzz ") + LEVEL_NAMES[level] + " ";
+    if (text.size() > maxLineLength_)
+        line += text.left(maxLineLength_) + QString(" ... (%1 chars)").arg(text.size());
+    else
+        line += text;
+
+    {
+        QMutexLocker locker(&mutex_);
+
+        ring_[count_ % ring_.size()] = line;
+        count_++;
+    }
+
+    if (writer_)
+        writer_->enqueue(line);
+}
+
+// Lines written after the "after" counter, the returned counter is the
+// one to pass next time.
+quint64 ServerLog::lines(quint64 after, QStringList &lines) const
+{
+    QMutexLocker locker(&mutex_);
+    quint64 first = count_ > quint64(ring_.size()) ? count_ - ring_.size() : 0;
+
+    for (quint64 x = qMax(after, first); x < count_; ++x)
+        lines << ring_[x % ring_.size()];
+
+    return count_;
+}
+
+//=============================================================================
+// class LogFileWriter
+//=============================================================================
+LogFileWriter::LogFileWriter(const QString &fileName, qint64 maxSize, int maxFiles) : QObject(0),
+    fileName_(fileName),
+    maxSize_(maxSize),
+    maxFiles_(maxFiles),
+    file_(fileName),
+    dropped_(0)
+{
+}
+
+void LogFileWriter::open()
+{
+    if (fileName_ == LOG_CONSOLE)
+        file_.open(stderr, QIODevice::WriteOnly | QIODevice::Text);
+    else
+        file_.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text);
+}
+
+void LogFileWriter::enqueue(const QString &line)
+{
+    bool schedule;
+
+    {
+        QMutexLocker locker(&mutex_);
+
+        if (pending_.size() >= MAX_PENDING_LINES) {
+            ++dropped_;
+            return;
+        }
+
+        schedule = pending_.isEmpty();
+        pending_ << line;
+    }
+
+    // one flush per batch, lines coming meanwhile join it
+    if (schedule == true)
+        QMetaObject::invokeMethod(this, "flush", Qt::QueuedConnection);
+}
+
+void LogFileWriter::flush()
+{
+    QStringList lines;
+    quint64 dropped;
+
+    {
+        QMutexLocker locker(&mutex_);
+
+        lines.swap(pending_);
+        dropped = dropped_;
+        dropped_ = 0;
+    }
+
+    if (dropped > 0)
+        lines << QString("%1 log lines dropped, the log file is not keeping up").arg(dropped);
+
+    if (lines.isEmpty() == true || file_.isOpen() == false)
+        return;
+
+    file_.write((lines.join("\n") + "\n").toUtf8());
+    file_.flush();
+
+    if (fileName_ != LOG_CONSOLE && maxSize_ > 0 && file_.size() > maxSize_)
+        rotate();
+}
+
+void LogFileWriter::rotate()
+{
+    file_.close();
+
+    QFile::remove(QString("%1.%2").arg(fileName_).arg(maxFiles_));
+    for (int x = maxFiles_ - 1; x > 0; --x)
+        QFile::rename(QString("%1.%2").arg(fileName_).arg(x), QString("%1.%2").arg(fileName_).arg(x + 1));
+    QFile::rename(fileName_, fileName_ + ".1");
+
+    file_.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text);
+}
@@ -0,0 +1,83 @@
+#ifndef SERVERLOG_H
+#define SERVERLOG_H
+
+#include <QObject>
+#include <QVector>
+#include <QStringList>
+#include <QMutex>
+#include <QThread>
+#include <QFile>
+
+class LogFileWriter;
+
+// log file name writing to stderr instead, e.g. for the systemd journal
+#define LOG_CONSOLE     "-"
+
+// Server log kept in a fixed ring of the last lines. Long payloads are
+// truncated, lines below the level are dropped, and the file sink is
+// written on its own thread so logging never waits on the disk. Safe to
+// call from any thread.
+class ServerLog : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Level {
+        Debug,
+        Info,
+        Warning,
+        Error
+    };
+
+    ServerLog(int capacity, int maxLineLength, QObject *parent = 0);
+    ~ServerLog();
+
+    void setLevel(Level level);
+    bool openFile(const QString &fileName, qint64 maxSize, int maxFiles);
+
+    void write(Level level, const QString &text);
+    quint64 lines(quint64 after, QStringList &lines) const;
+
+private:
+    mutable QMutex mutex_;
+    QVector<QString> ring_;
+    quint64 count_;
+    int maxLineLength_;
+    Level level_;
+
+    QThread writerThread_;
+    LogFileWriter *writer_;
+};
+
+// Appends log lines to a file on the log thread, rotating it into
+// name.1 ... name.N when it grows over the size limit, a limit of 0
+// never rotates. The console sink is never rotated. While the disk
+// falls behind at most a fixed number of lines wait, the rest are
+// dropped and counted in the file.
+class LogFileWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    LogFileWriter(const QString &fileName, qint64 maxSize, int maxFiles);
+
+    void enqueue(const QString &line);
+
+public Q_SLOTS:
+    void open();
+    void flush();
+
+private:
+    QString fileName_;
+    qint64 maxSize_;
+    int maxFiles_;
+    QFile file_;
+
+    QMutex mutex_;
+    QStringList pending_;
+    quint64 dropped_;
+
+    void rotate();
+};
+
+#endif // SERVERLOG_H
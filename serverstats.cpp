@@ -0,0 +1,213 @@
+#include <QThreadStorage>
+
+#include "serverstats.h"
+
+// upper bucket bounds in microseconds, the last bucket takes the rest
+static const qint64 BUCKET_BOUNDS[] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+    100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000
+};
+
+// time of the command running on the thread, by phase, ns
+struct PhaseTimes {
+    PhaseTimes() : db(0), serialize(0) {}
+
+    qint64 db;
+    qint64 serialize;
+};
+
+static QThreadStorage<PhaseTimes> phaseTimes;
+
+static double toMs(qint64 ns)
+{
+    return ns / 1000000.0;
+}
+
+ServerStats::Span::Span(Phase phase) :
+    phase_(phase)
+{
+    timer_.start();
+}
+
+ServerStats::Span::~Span()
+{
+    PhaseTimes &times = phaseTimes.localData();
+
+    if (phase_ == ServerStats::Db)
+        times.db += timer_.nsecsElapsed();
+    else
+        times.serialize += timer_.nsecsElapsed();
+}
+
+//=============================================================================
+// struct ServerStats::Histogram
+//=============================================================================
+ServerStats::Histogram::Histogram() :
+    count(0),
+    sumNs(0)
+{
+    for (int x = 0; x < BUCKETS; ++x)
+        buckets[x] = 0;
+}
+
+void ServerStats::Histogram::add(qint64 ns)
+{
+    int x = 0;
+
+    while (x < BUCKETS - 1 && ns > BUCKET_BOUNDS[x] * 1000)
+        x++;
+
+    buckets[x]++;
+    count++;
+    sumNs += ns;
+}
+
+// Upper bound of the bucket holding the q-th sample, ms. Samples over the
+// last bound report the last bound.
+double ServerStats::Histogram::percentile(double q) const
+{
+    quint64 rank = qMax(quint64(q * count + 0.5), quint64(1));
+    quint64 seen = 0;
+
+    if (count == 0)
+        return 0;
+
+    for (int x = 0; x < BUCKETS - 1; ++x) {
+        seen += buckets[x];
+        if (seen >= rank)
+            return BUCKET_BOUNDS[x] / 1000.0;
+    }
+
+    return BUCKET_BOUNDS[BUCKETS - 2] / 1000.0;
+}
+
+QVariantMap ServerStats::Histogram::toMap() const
+{
+    QVariantMap pMap;
+
+    pMap["avg"] = count > 0 ? toMs(sumNs) / count : 0.0;
+    pMap["p50"] = percentile(0.50);
+    pMap["p95"] = percentile(0.95);
+    pMap["p99"] = percentile(0.99);
+
+    return pMap;
+}
+
+//=============================================================================
+// class ServerStats
+//=============================================================================
+ServerStats::ServerStats(const QAtomicInt &queueDepth) :
+    queueDepth_(queueDepth)
+{
+    uptime_.start();
+}
+
+void ServerStats::beginCommand()
+{
+    phaseTimes.localData() = PhaseTimes();
+}
+
+void ServerStats::endCommand(const QString &cmd, qint64 elapsedNs)
+{
+    PhaseTimes times = phaseTimes.localData();
+    QMutexLocker locker(&mutex_);
+    CommandStats &stats = commands_[cmd];
+
+    stats.total.add(elapsedNs);
+    stats.db.add(times.db);
+    stats.serialize.add(times.serialize);
+}
+
+void ServerStats::connectionOpened()
+{
+    connections_.ref();
+}
+
+void ServerStats::connectionClosed()
+{
+    connections_.deref();
+}
+
+void ServerStats::addBytesIn(qint64 bytes)
+{
+    bytesIn_.fetchAndAddRelaxed(bytes);
+}
+
+void ServerStats::addBytesOut(qint64 bytes)
+{
+    bytesOut_.fetchAndAddRelaxed(bytes);
+}
+
+// Times in ms, as the CMD_GET_STATS reply body.
+QVariantMap ServerStats::toMap() const
+{
+    QVariantMap pMap;
+    QVariantMap commands;
+
+    pMap["uptime"] = uptime_.elapsed() / 1000;
+    pMap["connections"] = connections_.loadAcquire();
+    pMap["queue"] = queueDepth_.loadAcquire();
+    pMap["bytes_in"] = bytesIn_.loadAcquire();
+    pMap["bytes_out"] = bytesOut_.loadAcquire();
+
+    {
+        QMutexLocker locker(&mutex_);
+
+        for (QHash<QString, CommandStats>::const_iterator it = commands_.constBegin(); it != commands_.constEnd(); ++it) {
+            QVariantMap command;
+
+            command["count"] = it->total.count;
+            command["total"] = it->total.toMap();
+            command["db"] = it->db.toMap();
+            command["serialize"] = it->serialize.toMap();
+            commands[it.key()] = command;
+        }
+    }
+
+    pMap["commands"] = commands;
+
+    return pMap;
+}
+
+// Prometheus text exposition format, histograms in seconds.
+QByteArray ServerStats::toPrometheus() const
+{
+    static const char *PHASES[] = { "total", "db", "serialize" };
+    QByteArray out;
+
+    out += "# TYPE rpserver_uptime_seconds gauge\n";
+    out += "rpserver_uptime_seconds " + QByteArray::number(uptime_.elapsed() / 1000) + "\n";
+    out += "# TYPE rpserver_connections gauge\n";
+    out += "rpserver_connections " + QByteArray::number(connections_.loadAcquire()) + "\n";
+    out += "# TYPE rpserver_queue_depth gauge\n";
+    out += "rpserver_queue_depth " + QByteArray::number(queueDepth_.loadAcquire()) + "\n";
+    out += "# TYPE rpserver_received_bytes_total counter\n";
+    out += "rpserver_received_bytes_total " + QByteArray::number(bytesIn_.loadAcquire()) + "\n";
+    out += "# TYPE rpserver_sent_bytes_total counter\n";
+    out += "rpserver_sent_bytes_total " + QByteArray::number(bytesOut_.loadAcquire()) + "\n";
+    out += "# TYPE rpserver_command_seconds histogram\n";
+
+    QMutexLocker locker(&mutex_);
+
+    for (QHash<QString, CommandStats>::const_iterator it = commands_.constBegin(); it != commands_.constEnd(); ++it) {
+        const Histogram *histograms[] = { &it->total, &it->db, &it->serialize };
+
+        for (int phase = 0; phase < 3; ++phase) {
+            const Histogram &histogram = *histograms[phase];
+            QByteArray labels = "cmd=\"" + it.key().toUtf8() + "\",phase=\"" + PHASES[phase] + "\"";
+            quint64 cumulative = 0;
+
+            for (int x = 0; x < BUCKETS - 1; ++x) {
+                cumulative += histogram.buckets[x];
+                out += "rpserver_command_seconds_bucket{" + labels + ",le=\""
+                     + QByteArray::number(BUCKET_BOUNDS[x] / 1000000.0) + "\"} "
+                     + QByteArray::number(cumulative) + "\n";
+            }
+            out += "rpserver_command_seconds_bucket{" + labels + ",le=\"+Inf\"} " + QByteArray::number(histogram.count) + "\n";
+            out += "rpserver_command_seconds_sum{" + labels + "} " + QByteArray::number(histogram.sumNs / 1000000000.0) + "\n";
+            out += "rpserver_command_seconds_count{" + labels + "} " + QByteArray::number(histogram.count) + "\n";
+        }
+    }
+
+    return out;
+}
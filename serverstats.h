@@ -0,0 +1,79 @@
+#ifndef SERVERSTATS_H
+#define SERVERSTATS_H
+
+#include <QHash>
+#include <QVariant>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+
+// Per command counters and latency histograms, the handler time split
+// into time spent in the database and time spent encoding the reply,
+// plus connection and traffic gauges. Safe to call from any thread.
+class ServerStats
+{
+public:
+    enum Phase {
+        Db,
+        Serialize
+    };
+
+    // Adds the time it lives to the phase of the command running on the
+    // current thread.
+    class Span
+    {
+    public:
+        explicit Span(Phase phase);
+        ~Span();
+
+    private:
+        Phase phase_;
+        QElapsedTimer timer_;
+    };
+
+    explicit ServerStats(const QAtomicInt &queueDepth);
+
+    static void beginCommand();
+    void endCommand(const QString &cmd, qint64 elapsedNs);
+
+    void connectionOpened();
+    void connectionClosed();
+    void addBytesIn(qint64 bytes);
+    void addBytesOut(qint64 bytes);
+
+    QVariantMap toMap() const;
+    QByteArray toPrometheus() const;
+
+private:
+    static const int BUCKETS = 17;
+
+    struct Histogram {
+        Histogram();
+
+        void add(qint64 ns);
+        double percentile(double q) const;
+        QVariantMap toMap() const;
+
+        quint64 buckets[BUCKETS];
+        quint64 count;
+        qint64 sumNs;
+    };
+
+    struct CommandStats {
+        Histogram total;
+        Histogram db;
+        Histogram serialize;
+    };
+
+    const QAtomicInt &queueDepth_;
+    QElapsedTimer uptime_;
+
+    QAtomicInt connections_;
+    QAtomicInteger<qint64> bytesIn_;
+    QAtomicInteger<qint64> bytesOut_;
+
+    mutable QMutex mutex_;
+    QHash<QString, CommandStats> commands_;
+};
+
+#endif // SERVERSTATS_H
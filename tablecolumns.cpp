@@ -0,0 +1,81 @@
+#include <QStringList>
+#include <utility>
+
+#include "tablecolumns.h"
+#include "storage.h"
+
+qint64 GTableColumns::intValue( int row, int column ) const
+{
+    const Column &c = columns_[ column ];
+
+    return c.type == ctInt ? c.ints[ row ] : c.strings[ row ].toLongLong();
+}
+
+QString GTableColumns::text( int row, int column ) const
+{
+    const Column &c = columns_[ column ];
+
+    return c.type == ctInt ? QString::number( c.ints[ row ] ) : c.strings[ row ];
+}
+
+void GTableColumns::clear()
+{
+    columns_.clear();
+    rowCount_ = 0;
+}
+
+int getTableColumns( GStorage *storage, const QString &table, GTableColumns &data,
+                     const QList< int > &columns, const QList< int > &intColumns )
+{
+    QStringList dataList;
+
+    data.clear();
+
+    storage->getTableData( table );
+
+    while ( true ) {
+        dataList = storage->getTableRowData( table );
+        if ( dataList.count() == 0 )
+            break;
+
+        if ( data.rowCount_ == 0 )
+            data.columns_.resize( columns.isEmpty() ? dataList.count() : columns.count() );
+
+        // строка больше не нужна, значения забираются из нее без копий;
+        // столбец может быть заказан дважды, тогда значение копируется
+        for ( int x = 0; x < data.columns_.count(); ++x ) {
+            int y = columns.isEmpty() ? x : columns[ x ];
+
+            if ( y < 0 || y >= dataList.count() )
+                data.columns_[ x ].strings.append( QString() );
+            else if ( columns.isEmpty() == true )
+                data.columns_[ x ].strings.append( std::move( dataList[ y ] ) );
+            else
+                data.columns_[ x ].strings.append( dataList.at( y ) );
+        }
+        ++data.rowCount_;
+    }
+
+    // заказанные целые столбцы переводятся в числа один раз
+    foreach( int x, intColumns ) {
+        bool ok = true;
+
+        if ( x < 0 || x >= data.columns_.count() )
+            continue;
+
+        GTableColumns::Column &c = data.columns_[ x ];
+
+        c.ints.reserve( data.rowCount_ );
+        for ( int y = 0; y < data.rowCount_ && ok == true; ++y )
+            c.ints.append( c.strings[ y ].toLongLong( &ok ) );
+
+        if ( ok == true ) {
+            c.type = GTableColumns::ctInt;
+            c.strings.clear();
+        }
+        else
+            c.ints.clear();
+    }
+
+    return data.rowCount_;
+}
@@ -0,0 +1,59 @@
+#ifndef TABLECOLUMNS_H
+#define TABLECOLUMNS_H
+
+#include <QVector>
+#include <QString>
+#include <QList>
+
+class GStorage;
+
+// Результат запроса целиком, по столбцам. Значения хранятся строками как
+// есть, столбец, заказанный целым, - как QVector< qint64 >.
+class GTableColumns
+{
+public:
+    enum Type {
+        ctInt,
+        ctString
+    };
+
+    GTableColumns() : rowCount_( 0 ) {}
+
+    int rowCount() const { return rowCount_; }
+    int columnCount() const { return columns_.count(); }
+    Type type( int column ) const { return columns_[ column ].type; }
+
+    qint64 intValue( int row, int column ) const;
+    QString text( int row, int column ) const;
+
+    const QVector< qint64 > &ints( int column ) const { return columns_[ column ].ints; }
+    const QVector< QString > &strings( int column ) const { return columns_[ column ].strings; }
+
+    void clear();
+
+private:
+    struct Column {
+        Column() : type( ctString ) {}
+
+        Type type;
+        QVector< qint64 > ints;
+        QVector< QString > strings;
+    };
+
+    QVector< Column > columns_;
+    int rowCount_;
+
+    friend int getTableColumns( GStorage *storage, const QString &table, GTableColumns &data,
+                                const QList< int > &columns, const QList< int > &intColumns );
+};
+
+// Читает всю таблицу за один вызов и возвращает число строк. columns -
+// номера нужных столбцов в порядке результата, пустой список - все.
+// intColumns - номера столбцов результата, хранимых числами; столбец,
+// где не все значения целые, остается строковым. Пока GStorage отдает
+// только строки, таблица читается через getTableRowData; без проекции
+// значения переносятся в столбцы без копирования.
+int getTableColumns( GStorage *storage, const QString &table, GTableColumns &data,
+                     const QList< int > &columns = QList< int >(), const QList< int > &intColumns = QList< int >() );
+
+#endif // TABLECOLUMNS_H
@@ -0,0 +1,130 @@
+#include <QTimer>
+#include <QSet>
+
+#include "tablemonitor.h"
+#include "databackend.h"
+#include "api.h"
+
+// event posted by the occupancy triggers
+#define EVENT_TABLE_BUSY_CHANGED    "RP_TABLE_BUSY_CHANGED"
+
+TableMonitor::TableMonitor(const DataBackendFactory *backend, const QString &dbName, int pollInterval) : QObject(0),
+    backend_(backend),
+    dbName_(dbName),
+    pollInterval_(pollInterval),
+    pollTimer_(0),
+    connected_(false),
+    ready_(false)
+{
+}
+
+TableMonitor::~TableMonitor()
+{
+}
+
+QString TableMonitor::eventName()
+{
+    return EVENT_TABLE_BUSY_CHANGED;
+}
+
+bool TableMonitor::tables(QVariantList &tables) const
+{
+    QMutexLocker locker(&mutex_);
+
+    tables = tables_;
+    return ready_;
+}
+
+void TableMonitor::start()
+{
+    pollTimer_ = new QTimer(this);
+    connect(pollTimer_, &QTimer::timeout, this, &TableMonitor::refresh);
+    pollTimer_->start(pollInterval_ * 1000);
+
+    if (connectDatabase(true) == true)
+        refresh();
+}
+
+// Only the first failure is logged, the poll timer keeps trying.
+bool TableMonitor::connectDatabase(bool log)
+{
+    QString errText;
+
+    dataManager_.reset(backend_->create());
+    connected_ = dataManager_->connect(dbName_, "SYSDBA", "masterkey", errText);
+    if (connected_ == false && log == true)
+        Q_EMIT logMessage(trUtf8("Error connecting table monitor to database... ") + errText);
+    else if (connected_ == true && log == false)
+        Q_EMIT logMessage(trUtf8("Table monitor connected to database..."));
+
+    return connected_;
+}
+
+void TableMonitor::onDbEvent(const QString &name)
+{
+    if (name == EVENT_TABLE_BUSY_CHANGED && connected_ == true)
+        refresh();
+}
+
+void TableMonitor::refresh()
+{
+    QVariantList rows;
+    QVariantList changed;
+    QVariantList freed;
+    QSet<QString> keys;
+    QString errText;
+    bool first;
+
+    if (connected_ == false && connectDatabase(false) == false)
+        return;
+
+    rows = dataManager_->getTableBusy();
+
+    // no busy table at all may as well be a failed read, the next poll
+    // connects again
+    if (rows.isEmpty() == true && dataManager_->ping(errText) == false) {
+        connected_ = false;
+        return;
+    }
+
+    foreach (const QVariant &row, rows) {
+        QString key = row.toMap().value("id").toString();
+
+        keys.insert(key);
+        if (state_.value(key) != row) {
+            state_.insert(key, row);
+            changed << row;
+        }
+    }
+
+    // tables missing from the result are not busy any more
+    for (QHash<QString, QVariant>::iterator it = state_.begin(); it != state_.end(); ) {
+        if (keys.contains(it.key()) == false) {
+            freed << it.key();
+            it = state_.erase(it);
+        }
+        else
+            ++it;
+    }
+
+    {
+        QMutexLocker locker(&mutex_);
+
+        first = ready_ == false;
+        tables_ = rows;
+        ready_ = true;
+    }
+
+    if (first == true || (changed.isEmpty() == true && freed.isEmpty() == true))
+        return;
+
+    QVariantMap pMap;
+
+    pMap["err"] = ERROR::API_ERROR_NONE;
+    pMap["res"] = COMMAND::CMD_GET_TABLE_BUSY;
+    pMap["push"] = true;
+    pMap["tables"] = changed;
+    pMap["freed"] = freed;
+
+    Q_EMIT tablesChanged(pMap);
+}
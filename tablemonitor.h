@@ -0,0 +1,56 @@
+#ifndef TABLEMONITOR_H
+#define TABLEMONITOR_H
+
+#include <QObject>
+#include <QHash>
+#include <QMutex>
+#include <QScopedPointer>
+#include <QVariant>
+
+class QTimer;
+class DataBackend;
+class DataBackendFactory;
+
+// Watches table occupancy on its own thread and connection. The state is
+// read on every poll or occupancy event, only the tables that changed are
+// reported, once, for all the subscribers. A monitor started while the
+// database is down connects on a later poll, an empty read is only taken
+// for all tables freed while the database answers.
+class TableMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    TableMonitor(const DataBackendFactory *backend, const QString &dbName, int pollInterval);
+    ~TableMonitor();
+
+    static QString eventName();
+
+    bool tables(QVariantList &tables) const;
+
+public Q_SLOTS:
+    void start();
+    void refresh();
+    void onDbEvent(const QString &name);
+
+Q_SIGNALS:
+    void tablesChanged(const QVariantMap &body);
+    void logMessage(const QString &text);
+
+private:
+    const DataBackendFactory *backend_;
+    QString dbName_;
+    int pollInterval_;
+    QScopedPointer<DataBackend> dataManager_;
+    QTimer *pollTimer_;
+    bool connected_;
+
+    mutable QMutex mutex_;
+    bool ready_;
+    QVariantList tables_;
+    QHash<QString, QVariant> state_;
+
+    bool connectDatabase(bool log);
+};
+
+#endif // TABLEMONITOR_H